@@ -0,0 +1,75 @@
+#ifndef HAYWIRE_ALLOCATOR_HPP
+#define HAYWIRE_ALLOCATOR_HPP
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+
+#if defined(HAYWIRE_HUGE_PAGES) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace haywire
+{
+
+// The allocator of the chunk storage. It is std::allocator unless
+// HAYWIRE_HUGE_PAGES is defined. With it, blocks of 2 MiB or more are aligned
+// to 2 MiB and advised to be backed by transparent huge pages on Linux, so a
+// large world needs far fewer TLB entries.
+template<typename T>
+struct chunk_allocator
+{
+    using value_type = T;
+
+    static constexpr inline std::size_t huge_page_size = std::size_t(2) << 20;
+
+    chunk_allocator() noexcept = default;
+    template<typename U>
+    chunk_allocator(const chunk_allocator<U>&) noexcept {}
+
+    T* allocate(const std::size_t n)
+    {
+#if defined(HAYWIRE_HUGE_PAGES) && defined(__linux__)
+        if(is_huge(n))
+        {
+            const std::size_t bytes = (n * sizeof(T) + huge_page_size - 1) /
+                                      huge_page_size * huge_page_size;
+            void* ptr = std::aligned_alloc(huge_page_size, bytes);
+            if(ptr == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            ::madvise(ptr, bytes, MADV_HUGEPAGE); // just a hint
+            return static_cast<T*>(ptr);
+        }
+#endif
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* ptr, const std::size_t n) noexcept
+    {
+#if defined(HAYWIRE_HUGE_PAGES) && defined(__linux__)
+        if(is_huge(n))
+        {
+            std::free(ptr);
+            return;
+        }
+#endif
+        std::allocator<T>().deallocate(ptr, n);
+        return;
+    }
+
+  private:
+
+    static bool is_huge(const std::size_t n) noexcept
+    {
+        return huge_page_size / sizeof(T) <= n;
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const chunk_allocator<T>&, const chunk_allocator<U>&) noexcept {return true;}
+template<typename T, typename U>
+bool operator!=(const chunk_allocator<T>&, const chunk_allocator<U>&) noexcept {return false;}
+
+} // haywire
+#endif// HAYWIRE_ALLOCATOR_HPP
@@ -0,0 +1,256 @@
+#ifndef HAYWIRE_BATCH_HPP
+#define HAYWIRE_BATCH_HPP
+#include "world.hpp"
+#include "bitplane.hpp"
+#include "netlist.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+namespace haywire
+{
+
+// Simulates many instances of the same circuit at once, e.g. to test it with
+// different inputs. Instances share the conductor graph of the layout and
+// differ only in the positions of electrons.
+//
+// The states are stored as bit-planes over the instances: a node of the graph
+// has `lanes()` words of heads and tails, and the k-th bit of them is the
+// instance k. A step visits each node once and updates 64 instances per word
+// (256 with AVX2) with the same adders as bitplane_engine. The result of each
+// instance is the same as world::update().
+struct batch_engine
+{
+    using word_type = std::uint64_t;
+    static constexpr inline std::size_t word_bits     = 64;
+    static constexpr inline std::size_t parallel_grain = 1024; // nodes
+
+    // all the instances start from the state of the layout.
+    batch_engine(const world& layout, const std::size_t num_instances)
+        : graph_(layout), size_(num_instances),
+          lanes_(num_instances / word_bits + (num_instances % word_bits != 0)),
+          neighbors_((graph_.size() + 1) * 8, static_cast<std::uint32_t>(graph_.size())),
+          head_    ((graph_.size() + 1) * lanes_, 0u),
+          tail_    ((graph_.size() + 1) * lanes_, 0u),
+          head_buf_((graph_.size() + 1) * lanes_, 0u)
+    {
+        // missing neighbors point to the last node that never has a head
+        for(std::uint32_t i=0; i<graph_.size(); ++i)
+        {
+            std::copy(graph_.neighbors_begin(i), graph_.neighbors_end(i),
+                      neighbors_.begin() + i * 8);
+        }
+        for(std::size_t k=0; k<size_; ++k)
+        {
+            this->reset(k, layout);
+        }
+    }
+
+    // builds the instances from the layout and heads put on it. The layout
+    // should have only wires, and each instance has its own list of heads.
+    batch_engine(const world& layout,
+                 const std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>>& heads)
+        : batch_engine(layout, heads.size())
+    {
+        for(std::size_t k=0; k<heads.size(); ++k)
+        {
+            for(const auto& [x, y] : heads[k])
+            {
+                this->set(k, x, y, state::head);
+            }
+        }
+    }
+
+    void update()
+    {
+        const auto update_nodes = [this](const std::size_t first, const std::size_t last) {
+            for(std::size_t i=first; i<last; ++i)
+            {
+                std::size_t l = 0;
+#if defined(__AVX2__)
+                for(; l + 4 <= lanes_; l += 4)
+                {
+                    this->update_lanes<bitwise::avx2_word>(i, l);
+                }
+#endif
+                for(; l < lanes_; ++l)
+                {
+                    this->update_lanes<bitwise::scalar_word>(i, l);
+                }
+            }
+        };
+        if(pool_ && pool_->size() > 1 && graph_.size() > parallel_grain)
+        {
+            pool_->parallel_for(graph_.size(), parallel_grain, update_nodes);
+        }
+        else
+        {
+            update_nodes(0, graph_.size());
+        }
+        // head -> tail, tail -> wire, wire -> head (if 1 or 2 heads around)
+        std::swap(tail_, head_);
+        std::swap(head_, head_buf_);
+        return;
+    }
+
+    // cells of the instance k. Throws std::out_of_range if (x, y) is not a
+    // conductor of the layout.
+    state operator()(const std::size_t k, const std::int64_t x, const std::int64_t y) const
+    {
+        const auto [idx, bit] = this->locate(k, x, y);
+        if((head_[idx] & bit) != 0) {return state::head;}
+        if((tail_[idx] & bit) != 0) {return state::tail;}
+        return state::wire;
+    }
+    // s should not be vacuum, since the layout is shared.
+    void set(const std::size_t k, const std::int64_t x, const std::int64_t y, const state s)
+    {
+        if(s == state::vacuum)
+        {
+            throw std::invalid_argument("haywire::batch_engine::set: "
+                                        "conductors cannot be removed");
+        }
+        const auto [idx, bit] = this->locate(k, x, y);
+        head_[idx] = (s == state::head) ? (head_[idx] | bit) : (head_[idx] & ~bit);
+        tail_[idx] = (s == state::tail) ? (tail_[idx] | bit) : (tail_[idx] & ~bit);
+        return;
+    }
+
+    // sets the instance k to the state of a world of the same layout.
+    void reset(const std::size_t k, const world& w)
+    {
+        this->check_instance(k);
+        const word_type bit = word_type(1) << (k % word_bits);
+        for(std::uint32_t i=0; i<graph_.size(); ++i)
+        {
+            const std::size_t idx = i * lanes_ + k / word_bits;
+            const auto s = w(static_cast<std::int32_t>(graph_.x(i)),
+                             static_cast<std::int32_t>(graph_.y(i)));
+            head_[idx] = (s == state::head) ? (head_[idx] | bit) : (head_[idx] & ~bit);
+            tail_[idx] = (s == state::tail) ? (tail_[idx] | bit) : (tail_[idx] & ~bit);
+        }
+        return;
+    }
+
+    // writes the instance k into a world of the same size. Only the cells
+    // that differ are written, to keep the world quiescent.
+    void store(const std::size_t k, world& w) const
+    {
+        assert(w.width() == graph_.width() && w.height() == graph_.height());
+        this->check_instance(k);
+        const word_type bit = word_type(1) << (k % word_bits);
+        for(std::uint32_t i=0; i<graph_.size(); ++i)
+        {
+            const std::size_t idx = i * lanes_ + k / word_bits;
+            const state s = (head_[idx] & bit) ? state::head :
+                            (tail_[idx] & bit) ? state::tail : state::wire;
+            const auto x = static_cast<std::int32_t>(graph_.x(i));
+            const auto y = static_cast<std::int32_t>(graph_.y(i));
+            if(std::as_const(w)(x, y) != s)
+            {
+                w(x, y) = s;
+            }
+        }
+        return;
+    }
+
+    std::size_t num_heads(const std::size_t k) const
+    {
+        this->check_instance(k);
+        const word_type bit = word_type(1) << (k % word_bits);
+        std::size_t n = 0;
+        for(std::size_t i=0; i<graph_.size(); ++i)
+        {
+            n += (head_[i * lanes_ + k / word_bits] & bit) != 0;
+        }
+        return n;
+    }
+
+    // number of instances
+    std::size_t size()  const noexcept {return size_;}
+    // words per node
+    std::size_t lanes() const noexcept {return lanes_;}
+
+    std::size_t width()  const noexcept {return graph_.width() ;}
+    std::size_t height() const noexcept {return graph_.height();}
+
+    void set_num_threads(const std::size_t n)
+    {
+        if(n <= 1)
+        {
+            pool_.reset();
+        }
+        else if(not pool_ || pool_->size() != n)
+        {
+            pool_ = std::make_shared<thread_pool>(n);
+        }
+        return;
+    }
+    std::size_t num_threads() const noexcept
+    {
+        return pool_ ? pool_->size() : 1;
+    }
+
+  private:
+
+    // computes the next heads of the node i in lanes [l, l + width of W).
+    template<typename W>
+    void update_lanes(const std::size_t i, const std::size_t l) noexcept
+    {
+        const std::uint32_t* n = neighbors_.data() + i * 8;
+        const word_type*     h = head_.data() + l;
+
+        const W excited = bitwise::one_or_two(
+            W::load(h + n[0] * lanes_), W::load(h + n[1] * lanes_),
+            W::load(h + n[2] * lanes_), W::load(h + n[3] * lanes_),
+            W::load(h + n[4] * lanes_), W::load(h + n[5] * lanes_),
+            W::load(h + n[6] * lanes_), W::load(h + n[7] * lanes_));
+
+        const std::size_t idx = i * lanes_ + l;
+        const W wire = ~(W::load(head_.data() + idx) | W::load(tail_.data() + idx));
+        (wire & excited).store(head_buf_.data() + idx);
+        return;
+    }
+
+    // the index of the word and the bit of the instance k at (x, y)
+    std::pair<std::size_t, word_type>
+    locate(const std::size_t k, const std::int64_t x, const std::int64_t y) const
+    {
+        this->check_instance(k);
+        const auto i = graph_.find(x, y);
+        if(i == conductor_graph::npos)
+        {
+            throw std::out_of_range("haywire::batch_engine: (" + std::to_string(x) +
+                    ", " + std::to_string(y) + ") is not a conductor");
+        }
+        return {i * lanes_ + k / word_bits, word_type(1) << (k % word_bits)};
+    }
+
+    void check_instance(const std::size_t k) const
+    {
+        if(size_ <= k)
+        {
+            throw std::out_of_range("haywire::batch_engine: instance " +
+                    std::to_string(k) + " >= " + std::to_string(size_));
+        }
+        return;
+    }
+
+  private:
+    conductor_graph            graph_;
+    std::size_t                size_, lanes_;
+    std::vector<std::uint32_t> neighbors_; // 8 per node, padded with the last node
+    std::vector<word_type>     head_;      // lanes_ per node
+    std::vector<word_type>     tail_;
+    std::vector<word_type>     head_buf_;
+    std::shared_ptr<thread_pool> pool_;
+};
+
+} // haywire
+#endif// HAYWIRE_BATCH_HPP
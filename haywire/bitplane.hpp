@@ -0,0 +1,253 @@
+#ifndef HAYWIRE_BITPLANE_HPP
+#define HAYWIRE_BITPLANE_HPP
+#include "world.hpp"
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cassert>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace haywire
+{
+namespace bitwise
+{
+
+// Each bit of a word represents a cell. The following functions operate on
+// all the bits in parallel, so W can be any type that supports bitwise ops.
+
+template<typename W>
+W andnot(const W& a, const W& b) noexcept // ~a & b
+{
+    return ~a & b;
+}
+
+template<typename W>
+void full_adder(const W& a, const W& b, const W& c, W& sum, W& carry) noexcept
+{
+    const W t = a ^ b;
+    sum   = t ^ c;
+    carry = (a & b) | (t & c);
+    return;
+}
+template<typename W>
+void half_adder(const W& a, const W& b, W& sum, W& carry) noexcept
+{
+    sum   = a ^ b;
+    carry = a & b;
+    return;
+}
+
+// bits that have one or two flags in the 8 inputs.
+template<typename W>
+W one_or_two(const W& n0, const W& n1, const W& n2, const W& n3,
+             const W& n4, const W& n5, const W& n6, const W& n7) noexcept
+{
+    W s0, c0, s1, c1, s2, c2, s3, c3;
+    full_adder(n0, n1, n2, s0, c0);
+    full_adder(n3, n4, n5, s1, c1);
+    half_adder(n6, n7,     s2, c2);
+    full_adder(s0, s1, s2, s3, c3);
+
+    // the count is s3 + 2 * (c0 + c1 + c2 + c3).
+    const W twos_none = ~(c0 | c1 | c2 | c3);
+    const W twos_one  = ((c0 ^ c1) ^ (c2 ^ c3)) & ~((c0 & c1) | (c2 & c3));
+
+    return (s3 & twos_none) | andnot(s3, twos_one);
+}
+
+#if defined(__AVX2__)
+struct avx2_word
+{
+    __m256i v;
+
+    static avx2_word load(const std::uint64_t* p) noexcept
+    {
+        return avx2_word{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))};
+    }
+    void store(std::uint64_t* p) const noexcept
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+
+    avx2_word operator&(const avx2_word& o) const noexcept {return avx2_word{_mm256_and_si256(v, o.v)};}
+    avx2_word operator|(const avx2_word& o) const noexcept {return avx2_word{_mm256_or_si256 (v, o.v)};}
+    avx2_word operator^(const avx2_word& o) const noexcept {return avx2_word{_mm256_xor_si256(v, o.v)};}
+    avx2_word operator~() const noexcept
+    {
+        return avx2_word{_mm256_xor_si256(v, _mm256_set1_epi64x(-1))};
+    }
+    avx2_word operator<<(const int n) const noexcept {return avx2_word{_mm256_slli_epi64(v, n)};}
+    avx2_word operator>>(const int n) const noexcept {return avx2_word{_mm256_srli_epi64(v, n)};}
+};
+
+template<>
+inline avx2_word andnot(const avx2_word& a, const avx2_word& b) noexcept
+{
+    return avx2_word{_mm256_andnot_si256(a.v, b.v)};
+}
+#endif
+
+struct scalar_word
+{
+    std::uint64_t v;
+
+    static scalar_word load(const std::uint64_t* p) noexcept {return scalar_word{*p};}
+    void store(std::uint64_t* p) const noexcept {*p = v; return;}
+
+    scalar_word operator&(const scalar_word& o) const noexcept {return scalar_word{v & o.v};}
+    scalar_word operator|(const scalar_word& o) const noexcept {return scalar_word{v | o.v};}
+    scalar_word operator^(const scalar_word& o) const noexcept {return scalar_word{v ^ o.v};}
+    scalar_word operator~() const noexcept {return scalar_word{~v};}
+    scalar_word operator<<(const int n) const noexcept {return scalar_word{v << n};}
+    scalar_word operator>>(const int n) const noexcept {return scalar_word{v >> n};}
+};
+
+} // bitwise
+
+// Simulates a world as bit-planes. A row of cells is packed into 64-bit words
+// and one plane is used for each of conductors (wire, head and tail), heads,
+// and tails. The result is the same as world::update().
+struct bitplane_engine
+{
+    using word_type = std::uint64_t;
+    static constexpr inline std::size_t word_bits = 64;
+
+    explicit bitplane_engine(const world& w)
+        : width_(w.width()), height_(w.height()),
+          words_per_row_(w.width() / word_bits + (w.width() % word_bits != 0)),
+          stride_(words_per_row_ + 2),
+          conductor_((height_ + 2) * stride_, 0u),
+          head_     ((height_ + 2) * stride_, 0u),
+          tail_     ((height_ + 2) * stride_, 0u),
+          head_buf_ ((height_ + 2) * stride_, 0u)
+    {
+        for(std::size_t y=0; y<height_; ++y)
+        {
+            for(std::size_t x=0; x<width_; ++x)
+            {
+                const auto s = w(static_cast<std::int32_t>(x),
+                                 static_cast<std::int32_t>(y));
+                const auto idx = this->index(x, y);
+                const auto bit = word_type(1) << (x % word_bits);
+                if(s != state::vacuum) {conductor_[idx] |= bit;}
+                if(s == state::head)   {head_     [idx] |= bit;}
+                if(s == state::tail)   {tail_     [idx] |= bit;}
+            }
+        }
+    }
+
+    void update()
+    {
+        for(std::size_t y=0; y<height_; ++y)
+        {
+            const std::size_t row = (y + 1) * stride_ + 1;
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            for(; i + 4 <= words_per_row_; i += 4)
+            {
+                this->update_word<bitwise::avx2_word>(row + i);
+            }
+#endif
+            for(; i < words_per_row_; ++i)
+            {
+                this->update_word<bitwise::scalar_word>(row + i);
+            }
+        }
+        // head -> tail, tail -> wire, wire -> head (if 1 or 2 heads around)
+        std::swap(tail_, head_);
+        std::swap(head_, head_buf_);
+        return;
+    }
+
+    void store(world& w) const
+    {
+        assert(w.width() == width_ && w.height() == height_);
+
+        const std::size_t width_chunk  = width_  / chunk::width;
+        const std::size_t height_chunk = height_ / chunk::height;
+        for(std::size_t y_chk=0; y_chk<height_chunk; ++y_chk)
+        {
+            for(std::size_t x_chk=0; x_chk<width_chunk; ++x_chk)
+            {
+                chunk ch;
+                for(std::size_t y_rem=0; y_rem<chunk::height; ++y_rem)
+                {
+                    for(std::size_t x_rem=0; x_rem<chunk::width; ++x_rem)
+                    {
+                        ch(x_rem, y_rem) = (*this)(x_chk * chunk::width  + x_rem,
+                                                   y_chk * chunk::height + y_rem);
+                    }
+                }
+                // do not touch unchanged chunks to keep the world quiescent
+                const auto& self = std::as_const(w).chunk_at(x_chk, y_chk, std::nothrow);
+                if(self.cells != ch.cells)
+                {
+                    w.chunk_at(x_chk, y_chk, std::nothrow) = ch;
+                }
+            }
+        }
+        return;
+    }
+
+    state operator()(const std::size_t x, const std::size_t y) const noexcept
+    {
+        const auto idx = this->index(x, y);
+        const auto bit = word_type(1) << (x % word_bits);
+        if((conductor_[idx] & bit) == 0) {return state::vacuum;}
+        if((head_     [idx] & bit) != 0) {return state::head;}
+        if((tail_     [idx] & bit) != 0) {return state::tail;}
+        return state::wire;
+    }
+
+    std::size_t width()  const noexcept {return width_ ;}
+    std::size_t height() const noexcept {return height_;}
+
+  private:
+
+    std::size_t index(const std::size_t x, const std::size_t y) const noexcept
+    {
+        return (y + 1) * stride_ + 1 + x / word_bits;
+    }
+
+    // computes the next heads of words in [idx, idx + width of W).
+    // rows have a padding word at both ends and there are padding rows at
+    // the top and bottom, so the neighboring words are always accessible.
+    template<typename W>
+    void update_word(const std::size_t idx) noexcept
+    {
+        const word_type* up   = head_.data() + idx - stride_;
+        const word_type* mid  = head_.data() + idx;
+        const word_type* down = head_.data() + idx + stride_;
+
+        const W u = W::load(up),   u_l = W::load(up   - 1), u_r = W::load(up   + 1);
+        const W m = W::load(mid),  m_l = W::load(mid  - 1), m_r = W::load(mid  + 1);
+        const W d = W::load(down), d_l = W::load(down - 1), d_r = W::load(down + 1);
+
+        // align neighbors at x-1 and x+1 to the bit at x
+        const W uw = (u << 1) | (u_l >> 63), ue = (u >> 1) | (u_r << 63);
+        const W mw = (m << 1) | (m_l >> 63), me = (m >> 1) | (m_r << 63);
+        const W dw = (d << 1) | (d_l >> 63), de = (d >> 1) | (d_r << 63);
+
+        const W excited = bitwise::one_or_two(uw, u, ue, mw, me, dw, d, de);
+
+        const W cond = W::load(conductor_.data() + idx);
+        const W tail = W::load(tail_.data() + idx);
+        const W wire = bitwise::andnot(m | tail, cond);
+
+        (wire & excited).store(head_buf_.data() + idx);
+        return;
+    }
+
+  private:
+    std::size_t width_, height_, words_per_row_, stride_;
+    std::vector<word_type> conductor_;
+    std::vector<word_type> head_;
+    std::vector<word_type> tail_;
+    std::vector<word_type> head_buf_;
+};
+
+} // haywire
+#endif// HAYWIRE_BITPLANE_HPP
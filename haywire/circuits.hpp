@@ -0,0 +1,92 @@
+#ifndef HAYWIRE_CIRCUITS_HPP
+#define HAYWIRE_CIRCUITS_HPP
+#include "world.hpp"
+#include <random>
+#include <cstdint>
+
+// Canonical circuits used as benchmarks. They are generated deterministically
+// so that every run measures exactly the same board.
+
+namespace haywire
+{
+namespace circuits
+{
+
+// puts a clock of a 6x6 ring with one electron. period is 20.
+inline void put_clock(world& w, const std::int32_t x0, const std::int32_t y0)
+{
+    for(std::int32_t i=0; i<6; ++i)
+    {
+        w(x0 + i, y0    ) = state::wire;
+        w(x0 + i, y0 + 5) = state::wire;
+        w(x0    , y0 + i) = state::wire;
+        w(x0 + 5, y0 + i) = state::wire;
+    }
+    w(x0 + 2, y0) = state::tail;
+    w(x0 + 3, y0) = state::head;
+    return;
+}
+
+// fills the board with independent clocks, one per chunk. Every chunk is
+// always active.
+inline world clock_loops(const std::size_t width, const std::size_t height)
+{
+    world w(width, height);
+    for(std::size_t y=0; y + 8 <= w.height(); y += 8)
+    {
+        for(std::size_t x=0; x + 8 <= w.width(); x += 8)
+        {
+            put_clock(w, x + 1, y + 1);
+        }
+    }
+    return w;
+}
+
+// rows of a clock that drives a long wire with a diode every 16 cells.
+// Electrons run only in the forward direction.
+inline world diode_array(const std::size_t width, const std::size_t height)
+{
+    world w(width, height);
+    for(std::size_t y=0; y + 8 <= w.height(); y += 8)
+    {
+        put_clock(w, 1, y + 1);
+        const std::int32_t line = y + 3;
+        for(std::size_t x=7; x + 1 < w.width(); ++x)
+        {
+            w(x, line) = state::wire;
+        }
+        for(std::size_t gap=16; gap + 2 < w.width(); gap += 16)
+        {
+            w(gap,   line) = state::vacuum;
+            w(gap-1, line-1) = state::wire;
+            w(gap,   line-1) = state::wire;
+            w(gap-1, line+1) = state::wire;
+            w(gap,   line+1) = state::wire;
+        }
+    }
+    return w;
+}
+
+// random wires and electrons. std::mt19937 yields the same sequence on all
+// platforms, while the standard distributions do not. So use raw outputs.
+inline world random_mesh(const std::size_t width, const std::size_t height,
+                         const std::uint32_t seed = 123456789u)
+{
+    world w(width, height);
+    std::mt19937 rng(seed);
+    for(std::size_t y=0; y<w.height(); ++y)
+    {
+        for(std::size_t x=0; x<w.width(); ++x)
+        {
+            const auto r = rng() % 100;
+            if     (r < 1)  {w(x, y) = state::head;}
+            else if(r < 2)  {w(x, y) = state::tail;}
+            else if(r < 45) {w(x, y) = state::wire;}
+        }
+    }
+    return w;
+}
+
+} // circuits
+} // haywire
+#endif// HAYWIRE_CIRCUITS_HPP
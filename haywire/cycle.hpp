@@ -0,0 +1,147 @@
+#ifndef HAYWIRE_CYCLE_HPP
+#define HAYWIRE_CYCLE_HPP
+#include "world.hpp"
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+namespace haywire
+{
+
+// Finds a cycle of a world from the hashes of consecutive generations.
+//
+// Wireworld is deterministic, so once a state appears again, the world repeats
+// the generations between them forever. The detector keeps the hashes of the
+// last `capacity` generations and regards a period as found when it is seen
+// in two consecutive generations, so a single collision of the hashes is not
+// taken as a cycle. An edit breaks the cycle and the detector must be cleared.
+struct cycle_detector
+{
+    static constexpr inline std::size_t default_capacity = 65536;
+
+    explicit cycle_detector(const std::size_t capacity = default_capacity)
+        : capacity_(capacity)
+    {}
+
+    // called after each generation with world::hash(). If the generation does
+    // not follow the last one, the recorded hashes are discarded. Returns true
+    // if a cycle has been found.
+    bool observe(const std::uint64_t generation, const std::uint64_t hash)
+    {
+        if(is_started_ && generation != next_)
+        {
+            this->clear();
+        }
+        this->is_started_ = true;
+        this->next_       = generation + 1;
+        if(period_ != 0)
+        {
+            return true;
+        }
+
+        const auto found = table_.find(hash);
+        const std::uint64_t period = (found == table_.end()) ? 0 : generation - found->second;
+        if(period != 0 && period == candidate_)
+        {
+            // the previous generation was the first match
+            this->period_ = period;
+            this->start_  = found->second - 1;
+            this->recent_.clear();
+            this->table_.clear();
+            return true;
+        }
+        this->candidate_ = period;
+
+        this->table_[hash] = generation;
+        this->recent_.emplace_back(generation, hash);
+        while(capacity_ < recent_.size())
+        {
+            const auto [g, h] = recent_.front();
+            const auto iter = table_.find(h);
+            if(iter != table_.end() && iter->second == g)
+            {
+                table_.erase(iter);
+            }
+            recent_.pop_front();
+        }
+        return false;
+    }
+
+    bool has_cycle() const noexcept {return period_ != 0;}
+
+    // 0 if not found
+    std::uint64_t period() const noexcept {return period_;}
+
+    // a generation in the cycle. The generations before it may also be in it.
+    std::uint64_t start() const noexcept {return start_;}
+
+    // the position of the generation in the cycle, counted from start().
+    std::uint64_t phase(const std::uint64_t generation) const noexcept
+    {
+        return (period_ == 0 || generation < start_) ? 0 : (generation - start_) % period_;
+    }
+
+    // skips the whole periods between `from`, the last observed generation,
+    // and `to`. Returns the generation after the skip; the state of the world
+    // at `from` is also the state at the returned generation.
+    std::uint64_t skip(const std::uint64_t from, const std::uint64_t to) noexcept
+    {
+        if(period_ == 0 || to <= from || from + 1 != next_)
+        {
+            return from;
+        }
+        const std::uint64_t skipped = (to - from) / period_ * period_;
+        this->next_ += skipped;
+        return from + skipped;
+    }
+
+    void clear()
+    {
+        this->is_started_ = false;
+        this->next_       = 0;
+        this->period_     = 0;
+        this->start_      = 0;
+        this->candidate_  = 0;
+        this->recent_.clear();
+        this->table_.clear();
+        return;
+    }
+
+  private:
+    std::size_t   capacity_;
+    bool          is_started_ = false;
+    std::uint64_t next_       = 0; // generation expected in the next observe()
+    std::uint64_t period_     = 0;
+    std::uint64_t start_      = 0;
+    std::uint64_t candidate_  = 0; // period matched in the last generation
+
+    std::deque<std::pair<std::uint64_t, std::uint64_t>> recent_; // generation, hash
+    std::unordered_map<std::uint64_t, std::uint64_t>    table_;  // hash -> latest generation
+};
+
+// advances the world from `generation` to `target`. After the detector finds a
+// cycle, the whole periods are skipped and only the rest is simulated. Returns
+// the number of update() calls.
+template<std::size_t W, std::size_t H, typename Layout>
+std::uint64_t run_to(basic_world<W, H, Layout>& w, std::uint64_t& generation,
+                     const std::uint64_t target, cycle_detector& detector)
+{
+    std::uint64_t updates = 0;
+    while(generation < target)
+    {
+        generation = detector.skip(generation, target);
+        if(generation == target)
+        {
+            break;
+        }
+        w.update();
+        generation += 1;
+        updates    += 1;
+        detector.observe(generation, w.hash());
+    }
+    return updates;
+}
+
+} // haywire
+#endif// HAYWIRE_CYCLE_HPP
@@ -0,0 +1,330 @@
+#ifndef HAYWIRE_ENGINE_HPP
+#define HAYWIRE_ENGINE_HPP
+#include "world.hpp"
+#include "bitplane.hpp"
+#include "netlist.hpp"
+#include "hashlife.hpp"
+#include "sparse_world.hpp"
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+
+namespace haywire
+{
+
+enum class engine_kind: std::uint8_t {chunk, bitplane, netlist, hashlife, sparse};
+
+inline const char* engine_name(const engine_kind kind) noexcept
+{
+    switch(kind)
+    {
+        case engine_kind::chunk:    {return "chunk";}
+        case engine_kind::bitplane: {return "bitplane";}
+        case engine_kind::netlist:  {return "netlist";}
+        case engine_kind::hashlife: {return "hashlife";}
+        case engine_kind::sparse:   {return "sparse";}
+    }
+    return "unknown";
+}
+
+inline std::optional<engine_kind> engine_from_name(const std::string& name) noexcept
+{
+    for(const auto kind : {engine_kind::chunk, engine_kind::bitplane, engine_kind::netlist,
+                           engine_kind::hashlife, engine_kind::sparse})
+    {
+        if(name == engine_name(kind))
+        {
+            return kind;
+        }
+    }
+    return std::nullopt;
+}
+
+// A simulation engine bound to a world. The world is the source of truth:
+// an engine builds its own representation from the world when it steps, and
+// store() writes the state back. Chunks written by store() become dirty in
+// the world, so the dirty chunks are queried through the world. If the world
+// is modified directly, reset() must be called to discard the representation.
+//
+// The chunk engine is the reference and steps the world itself.
+struct engine
+{
+    explicit engine(world& w) noexcept: world_(w) {}
+    virtual ~engine() = default;
+
+    engine(const engine&) = delete;
+    engine(engine&&)      = delete;
+    engine& operator=(const engine&) = delete;
+    engine& operator=(engine&&)      = delete;
+
+    virtual engine_kind kind() const noexcept = 0;
+
+    // advances n generations.
+    virtual void step(const std::size_t n) = 0;
+
+    // cells in the world coordinates. Cells out of the world are vacuum and
+    // cannot be written.
+    virtual state get(const std::int64_t x, const std::int64_t y) const = 0;
+    virtual void  set(const std::int64_t x, const std::int64_t y, const state s) = 0;
+
+    // writes the state into the world and re-counts the chunks written, so
+    // that the statistics and the hash of the world are valid.
+    virtual void store() = 0;
+    virtual void reset() = 0;
+
+    // calls f(x_chk, y_chk) for each chunk changed since the last
+    // world::clear_dirty().
+    template<typename F>
+    void for_each_dirty_chunk(F&& f)
+    {
+        this->store();
+        world_.for_each_dirty_chunk(std::forward<F>(f));
+        return;
+    }
+
+    world&       target()       noexcept {return world_;}
+    world const& target() const noexcept {return world_;}
+
+  protected:
+
+    bool contains(const std::int64_t x, const std::int64_t y) const noexcept
+    {
+        return 0 <= x && x < static_cast<std::int64_t>(world_.width()) &&
+               0 <= y && y < static_cast<std::int64_t>(world_.height());
+    }
+    void check_range(const std::int64_t x, const std::int64_t y) const
+    {
+        if(not this->contains(x, y))
+        {
+            throw std::out_of_range(std::string("haywire::engine::set: (") +
+                std::to_string(x) + ", " + std::to_string(y) + ") is out of " +
+                std::to_string(world_.width()) + "x" + std::to_string(world_.height()));
+        }
+        return;
+    }
+
+  protected:
+    world& world_;
+};
+
+// world::update() on the world itself.
+struct chunk_engine final : engine
+{
+    explicit chunk_engine(world& w) noexcept: engine(w) {}
+
+    engine_kind kind() const noexcept override {return engine_kind::chunk;}
+
+    void step(const std::size_t n) override
+    {
+        for(std::size_t i=0; i<n; ++i)
+        {
+            this->world_.update();
+        }
+        return;
+    }
+    state get(const std::int64_t x, const std::int64_t y) const override
+    {
+        return std::as_const(world_)(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y));
+    }
+    void set(const std::int64_t x, const std::int64_t y, const state s) override
+    {
+        this->check_range(x, y);
+        this->world_(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y)) = s;
+        return;
+    }
+    void store() override {return;}
+    void reset() override {return;}
+};
+
+// the other engines are constructed from the world when they step, and
+// discarded when a cell is written or the world is modified.
+template<typename Engine, engine_kind Kind>
+struct engine_adapter final : engine
+{
+    explicit engine_adapter(world& w) noexcept: engine(w) {}
+
+    engine_kind kind() const noexcept override {return Kind;}
+
+    void step(const std::size_t n) override
+    {
+        if(not impl_)
+        {
+            this->impl_.emplace(world_);
+        }
+        if constexpr(std::is_same_v<Engine, hashlife_engine>)
+        {
+            this->impl_->step(n); // all the generations at once
+        }
+        else
+        {
+            for(std::size_t i=0; i<n; ++i)
+            {
+                this->impl_->update();
+            }
+        }
+        this->is_stored_ = false;
+        return;
+    }
+    state get(const std::int64_t x, const std::int64_t y) const override
+    {
+        if(not this->contains(x, y))
+        {
+            return state::vacuum;
+        }
+        if(impl_)
+        {
+            return (*impl_)(x, y);
+        }
+        return std::as_const(world_)(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y));
+    }
+    void set(const std::int64_t x, const std::int64_t y, const state s) override
+    {
+        this->check_range(x, y);
+        this->store();
+        this->world_(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y)) = s;
+        this->impl_.reset();
+        return;
+    }
+    void store() override
+    {
+        if(impl_ && not is_stored_)
+        {
+            this->impl_->store(world_);
+            this->world_.recount_edited(); // only the chunks written by store()
+            this->is_stored_ = true;
+        }
+        return;
+    }
+    void reset() override
+    {
+        this->impl_.reset();
+        this->is_stored_ = true;
+        return;
+    }
+
+  private:
+    std::optional<Engine> impl_;
+    bool                  is_stored_ = true;
+};
+
+inline std::unique_ptr<engine> make_engine(const engine_kind kind, world& w)
+{
+    switch(kind)
+    {
+        case engine_kind::chunk:
+        {
+            return std::make_unique<chunk_engine>(w);
+        }
+        case engine_kind::bitplane:
+        {
+            return std::make_unique<engine_adapter<bitplane_engine, engine_kind::bitplane>>(w);
+        }
+        case engine_kind::netlist:
+        {
+            return std::make_unique<engine_adapter<netlist_engine, engine_kind::netlist>>(w);
+        }
+        case engine_kind::hashlife:
+        {
+            return std::make_unique<engine_adapter<hashlife_engine, engine_kind::hashlife>>(w);
+        }
+        case engine_kind::sparse:
+        {
+            return std::make_unique<engine_adapter<sparse_world, engine_kind::sparse>>(w);
+        }
+    }
+    throw std::invalid_argument("haywire::make_engine: unknown engine");
+}
+
+// the first difference found by cross_validate()
+struct divergence
+{
+    std::uint64_t generation; // counted from the start of the validation
+    std::size_t   x, y;       // the first chunk that differs in row-major order
+};
+
+// returns the first chunk that differs between worlds of the same size.
+inline std::optional<std::pair<std::size_t, std::size_t>>
+first_different_chunk(const world& lhs, const world& rhs)
+{
+    const std::size_t width_chunk  = std::min(lhs.width(),  rhs.width())  / chunk::width;
+    const std::size_t height_chunk = std::min(lhs.height(), rhs.height()) / chunk::height;
+    for(std::size_t y=0; y<height_chunk; ++y)
+    {
+        for(std::size_t x=0; x<width_chunk; ++x)
+        {
+            if(lhs.chunk_at(x, y, std::nothrow).cells != rhs.chunk_at(x, y, std::nothrow).cells)
+            {
+                return std::make_pair(x, y);
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+// Runs a candidate engine in lockstep with the chunk engine from the same
+// world and compares the hashes of the worlds every `every` generations. On a
+// mismatch, both are re-run from the last matching generation one step at a
+// time to find the first generation and chunk that differ. Returns nullopt if
+// they match for all the `gens` generations.
+inline std::optional<divergence>
+cross_validate(const world& initial, const engine_kind candidate,
+               const std::size_t gens, const std::size_t every)
+{
+    world reference_world(initial), candidate_world(initial);
+    reference_world.recount();
+    candidate_world.recount();
+
+    // the last generation where both match
+    world         reference_ok(reference_world), candidate_ok(candidate_world);
+    std::uint64_t generation_ok = 0;
+
+    const auto reference = make_engine(engine_kind::chunk, reference_world);
+    const auto target    = make_engine(candidate,          candidate_world);
+    const std::size_t block = std::max<std::size_t>(every, 1);
+    for(std::size_t done=0; done < gens; )
+    {
+        const std::size_t n = std::min(block, gens - done);
+        reference->step(n);
+        target   ->step(n);
+        target   ->store();
+        done += n;
+        if(reference_world.hash() == candidate_world.hash())
+        {
+            reference_ok  = reference_world;
+            candidate_ok  = candidate_world;
+            generation_ok = done;
+            continue;
+        }
+
+        const auto ref = make_engine(engine_kind::chunk, reference_ok);
+        const auto cnd = make_engine(candidate,          candidate_ok);
+        for(std::uint64_t g = generation_ok + 1; g <= done; ++g)
+        {
+            ref->step(1);
+            cnd->step(1);
+            cnd->store();
+            if(const auto found = first_different_chunk(reference_ok, candidate_ok))
+            {
+                return divergence{g, found->first, found->second};
+            }
+        }
+        // the re-run from the last match did not reproduce it, e.g. the
+        // candidate depends on its history. reports the current difference.
+        if(const auto found = first_different_chunk(reference_world, candidate_world))
+        {
+            return divergence{done, found->first, found->second};
+        }
+        reference_ok  = reference_world;
+        candidate_ok  = candidate_world;
+        generation_ok = done;
+    }
+    return std::nullopt;
+}
+
+} // haywire
+#endif// HAYWIRE_ENGINE_HPP
@@ -1,14 +1,29 @@
 #ifndef HAYWIRE_GUI_HPP
 #define HAYWIRE_GUI_HPP
 #include "world.hpp"
+#include "simulator.hpp"
+#include "snapshot.hpp"
+#include "rle.hpp"
+#include "overlay.hpp"
+#include "saver.hpp"
 #include <extlib/wad/wad/in_place.hpp>
 #include <extlib/wad/wad/interface.hpp>
 #include <extlib/wad/wad/default_archiver.hpp>
 #include <SDL.h>
+#include <algorithm>
+#include <array>
 #include <stdexcept>
 #include <string>
+#include <fstream>
 #include <memory>
+#include <optional>
+#include <tuple>
+#include <vector>
 #include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <ctime>
 #include <iostream>
 
 namespace haywire
@@ -51,6 +66,106 @@ struct sdl_resource
     bool should_quit_;
 };
 
+// frame time and CPU time of the calling thread, summarized every second.
+// The frame time does not include the time spent waiting for events. Time
+// spent in handling events and drawing is also measured as a part of it.
+struct frame_stats
+{
+    using clock_type = std::chrono::steady_clock;
+
+    struct summary
+    {
+        double frames_per_sec;
+        double draws_per_sec;
+        double mean_frame_ms;
+        double max_frame_ms;
+        double mean_event_ms; // per frame
+        double mean_draw_ms;  // per drawn frame
+        double cpu_percent;   // of one core
+    };
+
+    frame_stats(): start_(clock_type::now()), cpu_start_(thread_cpu_time()) {}
+
+    void begin_frame() noexcept
+    {
+        this->frame_start_ = clock_type::now();
+        return;
+    }
+    void end_frame(const bool is_drawn) noexcept
+    {
+        const double ms = std::chrono::duration<double, std::milli>(
+                clock_type::now() - frame_start_).count();
+        this->frames_   += 1;
+        this->draws_    += is_drawn ? 1 : 0;
+        this->total_ms_ += ms;
+        this->max_ms_    = std::max(max_ms_, ms);
+        return;
+    }
+
+    void add_event_time(const clock_type::duration t) noexcept
+    {
+        this->event_ms_ += std::chrono::duration<double, std::milli>(t).count();
+        return;
+    }
+    void add_draw_time(const clock_type::duration t) noexcept
+    {
+        this->draw_ms_ += std::chrono::duration<double, std::milli>(t).count();
+        return;
+    }
+
+    bool is_ready() const noexcept
+    {
+        return std::chrono::seconds(1) <= clock_type::now() - start_;
+    }
+
+    // returns the summary since the last call and resets the counters.
+    summary summarize() noexcept
+    {
+        const auto   now = clock_type::now();
+        const double cpu = thread_cpu_time();
+        const double sec = std::chrono::duration<double>(now - start_).count();
+
+        const summary retval{frames_ / sec, draws_ / sec,
+            (frames_ == 0) ? 0.0 : total_ms_ / frames_, max_ms_,
+            (frames_ == 0) ? 0.0 : event_ms_ / frames_,
+            (draws_  == 0) ? 0.0 : draw_ms_  / draws_,
+            100.0 * (cpu - cpu_start_) / sec};
+
+        this->start_     = now;
+        this->cpu_start_ = cpu;
+        this->frames_    = 0;
+        this->draws_     = 0;
+        this->total_ms_  = 0.0;
+        this->max_ms_    = 0.0;
+        this->event_ms_  = 0.0;
+        this->draw_ms_   = 0.0;
+        return retval;
+    }
+
+    // in seconds. falls back to the CPU time of the process.
+    static double thread_cpu_time() noexcept
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        timespec ts;
+        if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        {
+            return ts.tv_sec + ts.tv_nsec * 1e-9;
+        }
+#endif
+        return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+    }
+
+  private:
+    clock_type::time_point start_, frame_start_;
+    double      cpu_start_;
+    std::size_t frames_   = 0;
+    std::size_t draws_    = 0;
+    double      total_ms_ = 0.0;
+    double      max_ms_   = 0.0;
+    double      event_ms_ = 0.0;
+    double      draw_ms_  = 0.0;
+};
+
 struct window
 {
     using window_resource_type   =
@@ -58,19 +173,22 @@ struct window
     using renderer_resource_type =
         std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)>;
     using sdl_resource_type = sdl_resource;
+    using engine_kind       = simulator::engine_kind;
 
     window(): window(640, 480, 20) {}
 
+    // the simulation runs on its own thread. The window draws snapshots of it
+    // and sends edits as commands.
     window(std::size_t w, std::size_t h, std::size_t c)
-    : origin_x_(0), origin_y_(0), cell_size_(c), world_(w/c+1, h/c+1), resource_(),
+    : origin_x_(0), origin_y_(0), cell_size_(c),
+      saver_(std::make_unique<background_saver>(num_autosaves, &window::report_saved,
+                                                autosave_prefix)),
+      simulator_(std::make_unique<simulator>(world(w/c+1, h/c+1))), resource_(),
       window_(SDL_CreateWindow("haywire", 0, 0, w, h, SDL_WINDOW_RESIZABLE),
               &SDL_DestroyWindow),
       renderer_(SDL_CreateRenderer(window_.get(), -1, 0), &SDL_DestroyRenderer)
     {
         SDL_GetMouseState(&mouse_prev_x_, &mouse_prev_y_);
-
-        assert(origin_x_ + w < world_.width()  * cell_size_);
-        assert(origin_y_ + h < world_.height() * cell_size_);
     }
     ~window() = default;
     window(const window&) = delete;
@@ -78,109 +196,183 @@ struct window
     window& operator=(const window&) = delete;
     window& operator=(window&&)      = default;
 
+    // handles all the pending events and draws a frame if something has been
+    // changed. While nothing changes without events, e.g. paused, it sleeps
+    // until an event arrives.
     bool update()
     {
-        const auto fps60 = std::chrono::system_clock::now() +
-                           std::chrono::milliseconds(16);
-
-        if(this->is_running_)
+        SDL_Event event;
+        if(this->is_idle())
         {
-            this->world_.update();
+            if(SDL_WaitEventTimeout(&event, idle_timeout_ms) != 0 &&
+               not this->handle_event(event))
+            {
+                return false;
+            }
         }
+        const auto frame_start = std::chrono::steady_clock::now();
+        stats_.begin_frame();
 
-        this->draw();
-        if(not this->handle_event()){return false;}
+        while(SDL_PollEvent(&event) != 0)
+        {
+            if(not this->handle_event(event)){return false;}
+        }
+        stats_.add_event_time(std::chrono::steady_clock::now() - frame_start);
+        this->expand_world();
+        this->acquire_snapshot();
 
-        while(std::chrono::system_clock::now() < fps60)
+        const bool is_drawn = this->is_world_changed_ || this->is_window_changed_ ||
+                              this->current_view() != this->texture_view_;
+        if(is_drawn)
         {
+            const auto draw_start = std::chrono::steady_clock::now();
             this->draw();
-            if(not this->handle_event()){return false;}
+            stats_.add_draw_time(std::chrono::steady_clock::now() - draw_start);
+        }
+        stats_.end_frame(is_drawn);
+        this->update_title();
+        this->autosave();
+
+        if(not this->is_idle())
+        {
+            std::this_thread::sleep_until(frame_start + frame_interval);
         }
         return true;
     }
 
+    // cells are written into a streaming texture, one pixel per cell, and the
+    // texture is scaled by the renderer. Borders between cells are drawn by
+    // overlaying a grid texture. The texture is re-written only when a new
+    // snapshot arrives or the view has been changed.
     void draw()
     {
+        const world& snapshot = simulator_->snapshot();
+
         SDL_SetRenderDrawColor(renderer_.get(), 0,0,0,0xFF);
         SDL_RenderClear(renderer_.get());
 
         const auto [window_width, window_height] = this->window_size();
 
-        const std::size_t cell_begin_x = origin_x_ / cell_size_;
-        const std::size_t cell_begin_y = origin_y_ / cell_size_;
-        const std::size_t cell_end_x   = (origin_x_ + window_width)  / cell_size_;
-        const std::size_t cell_end_y   = (origin_y_ + window_height) / cell_size_;
+        const auto view = this->current_view();
+        const std::int64_t cell = cell_size_;
+        const std::int64_t left = std::get<0>(view);
+        const std::int64_t top  = std::get<1>(view);
+
+        const std::int64_t width  = snapshot.width();
+        const std::int64_t height = snapshot.height();
+        const std::int64_t cell_begin_x = std::clamp<std::int64_t>(floor_div(left, cell), 0, width);
+        const std::int64_t cell_begin_y = std::clamp<std::int64_t>(floor_div(top,  cell), 0, height);
+        const std::int64_t cell_end_x   = std::clamp<std::int64_t>(
+                floor_div(left + window_width,  cell) + 1, cell_begin_x, width);
+        const std::int64_t cell_end_y   = std::clamp<std::int64_t>(
+                floor_div(top  + window_height, cell) + 1, cell_begin_y, height);
 
-        const int border = (5 <= cell_size_) ? 1 : 0;
+        // the texture has enough size to cover the window at any offset
+        const int texture_width  = window_width  / cell_size_ + 2;
+        const int texture_height = window_height / cell_size_ + 2;
+        if(not cells_texture_ || texture_width  != cells_texture_width_ ||
+                                 texture_height != cells_texture_height_)
+        {
+            this->cells_texture_ = texture_resource_type(SDL_CreateTexture(
+                renderer_.get(), SDL_PIXELFORMAT_ARGB8888,
+                SDL_TEXTUREACCESS_STREAMING, texture_width, texture_height),
+                &SDL_DestroyTexture);
+            this->cells_texture_width_  = texture_width;
+            this->cells_texture_height_ = texture_height;
+            this->needs_full_repaint_   = true;
+        }
 
-        SDL_Rect rect;
-        rect.w = cell_size_- 2 * border;
-        rect.h = cell_size_- 2 * border;
-        for(std::size_t y = cell_begin_y; y < cell_end_y; ++y)
+        if(lod_ != 0)
+        {
+            // zoomed out below a pixel per cell, each pixel is read from the
+            // overview of the world, so the cost depends only on the window.
+            if(this->needs_full_repaint_ || view != this->texture_view_ || this->is_world_changed_)
+            {
+                this->write_overview(snapshot, window_width, window_height);
+                this->needs_full_repaint_ = false;
+            }
+            const SDL_Rect rect{0, 0, window_width, window_height};
+            SDL_RenderCopy(renderer_.get(), cells_texture_.get(), &rect, &rect);
+        }
+        else
         {
-            for(std::size_t x = cell_begin_x; x < cell_end_x; ++x)
+            // the texture is kept between frames. Only the changed chunks are
+            // re-written unless the view moves.
+            if(this->needs_full_repaint_ || view != this->texture_view_)
+            {
+                this->write_cells(snapshot, cell_begin_x, cell_begin_y, cell_end_x, cell_end_y);
+                this->needs_full_repaint_ = false;
+            }
+            else if(this->is_world_changed_)
             {
-                const auto cell_x = x * cell_size_ - origin_x_;
-                const auto cell_y = y * cell_size_ - origin_y_;
+                this->write_dirty_cells(snapshot, cell_begin_x, cell_begin_y, cell_end_x, cell_end_y);
+            }
 
-                switch(std::as_const(world_)(x, y))
+            const SDL_Rect src{0, 0,
+                static_cast<int>(cell_end_x - cell_begin_x),
+                static_cast<int>(cell_end_y - cell_begin_y)};
+            const SDL_Rect dst{
+                static_cast<int>(cell_begin_x * cell - left),
+                static_cast<int>(cell_begin_y * cell - top),
+                static_cast<int>(src.w * cell_size_), static_cast<int>(src.h * cell_size_)};
+            if(0 < src.w && 0 < src.h)
+            {
+                SDL_RenderCopy(renderer_.get(), cells_texture_.get(), &src, &dst);
+
+                if(5 <= cell_size_)
                 {
-                    case state::vacuum:
-                    {
-                        continue;
-                    }
-                    case state::wire:
-                    {
-                        SDL_SetRenderDrawColor(renderer_.get(), 0xFF, 0xFF, 0x00, 0xFF);
-                        break;
-                    }
-                    case state::head:
-                    {
-                        SDL_SetRenderDrawColor(renderer_.get(), 0xFF, 0x00, 0x00, 0xFF);
-                        break;
-                    }
-                    case state::tail:
-                    {
-                        SDL_SetRenderDrawColor(renderer_.get(), 0x00, 0x00, 0xFF, 0xFF);
-                        break;
-                    }
+                    this->draw_grid(texture_width, texture_height, dst);
                 }
-                rect.x = cell_x + border;
-                rect.y = cell_y + border;
-                SDL_RenderFillRect(renderer_.get(), &rect);
             }
         }
+        this->texture_view_     = view;
+        this->is_world_changed_ = false;
+
+        if(this->selection_)
+        {
+            this->draw_selection();
+        }
+        if(this->is_overlay_shown_)
+        {
+            this->draw_overlay();
+        }
         SDL_RenderPresent(renderer_.get());
+        this->is_window_changed_ = false;
         return ;
     }
 
-    bool handle_event()
+    bool handle_event(const SDL_Event& event)
     {
-        SDL_Event event;
-        SDL_PollEvent(&event);
-
         switch(event.type)
         {
             case SDL_QUIT: {return false;}
             case SDL_WINDOWEVENT:
             {
-                switch(event.window.event)
-                {
-                    case SDL_WINDOWEVENT_RESIZED:
-                    {
-                        this->expand_world();
-                        break;
-                    }
-                    default: {break;}
-                }
+                this->is_window_changed_ = true; // resized, exposed, etc.
                 break;
             }
             case SDL_MOUSEWHEEL:
             {
+                // below 1 pixel per cell, a step halves or doubles the scale
+                const auto [window_width, window_height] = this->window_size();
+                if((lod_ != 0 && 0 < event.wheel.y) ||
+                   (cell_size_ == 1 && event.wheel.y < 0 && lod_ < max_lod))
+                {
+                    const double ratio = (0 < event.wheel.y) ? 2.0 : 0.5;
+                    const auto center_x = this->origin_x_ + window_width  / 2;
+                    const auto center_y = this->origin_y_ + window_height / 2;
+                    this->origin_x_ = center_x * ratio - window_width  / 2;
+                    this->origin_y_ = center_y * ratio - window_height / 2;
+                    this->lod_ = (0 < event.wheel.y) ? lod_ - 1 : lod_ + 1;
+                    break;
+                }
+                if(lod_ != 0)
+                {
+                    break;
+                }
                 std::int32_t cell_size = this->cell_size_;
                 cell_size += event.wheel.y;
 
-                const auto [window_width, window_height] = this->window_size();
                 const double ratio = std::max<double>(1, cell_size) / this->cell_size_;
 
                 const auto center_x = this->origin_x_ + window_width  / 2;
@@ -190,39 +382,48 @@ struct window
                 this->origin_y_ = center_y * ratio - window_height / 2;
 
                 this->cell_size_ = std::max(1, cell_size);
-                this->expand_world();
                 break;
             }
             case SDL_MOUSEBUTTONDOWN:
             {
                 this->is_mouse_button_down_ = true;
+                if((SDL_GetModState() & KMOD_SHIFT) != 0) // Shift-drag selects cells
+                {
+                    const std::int64_t x = this->cell_of(event.button.x + origin_x_);
+                    const std::int64_t y = this->cell_of(event.button.y + origin_y_);
+                    this->is_selecting_ = true;
+                    this->selection_    = selection{x, y, x + 1, y + 1};
+                    this->select_from_x_ = x;
+                    this->select_from_y_ = y;
+                    this->is_window_changed_ = true;
+                }
                 break;
             }
             case SDL_MOUSEBUTTONUP:
             {
-                if(not is_mouse_dragging_)
+                if(is_selecting_)
                 {
-                    const std::int32_t x = (event.button.x + origin_x_) / cell_size_;
-                    const std::int32_t y = (event.button.y + origin_y_) / cell_size_;
+                    this->is_selecting_ = false;
+                }
+                else if(not is_mouse_dragging_)
+                {
+                    const std::int64_t x = this->cell_of(event.button.x + origin_x_);
+                    const std::int64_t y = this->cell_of(event.button.y + origin_y_);
 
-                    switch(std::as_const(world_)(x, y))
+                    state next = state::vacuum;
+                    switch(this->cell_at(x, y))
                     {
-                        case state::vacuum: {world_(x, y) = state::wire;   break;}
+                        case state::vacuum: {next = state::wire;   break;}
                         case state::wire:
                         {
-                            if(event.button.clicks == 2)
-                            {
-                                world_(x, y) = state::vacuum;
-                            }
-                            else
-                            {
-                                world_(x, y) = state::head;
-                            }
+                            next = (event.button.clicks == 2) ? state::vacuum : state::head;
                             break;
                         }
-                        case state::head:   {world_(x, y) = state::tail;   break;}
-                        case state::tail:   {world_(x, y) = state::vacuum; break;}
+                        case state::head:   {next = state::tail;   break;}
+                        case state::tail:   {next = state::vacuum; break;}
                     }
+                    this->pending_.push_back(edit{x, y, next,
+                            simulator_->set_cell(x, y, next)});
                 }
                 this->drag_x_ = 0;
                 this->drag_y_ = 0;
@@ -234,7 +435,16 @@ struct window
             }
             case SDL_MOUSEMOTION:
             {
-                if(is_mouse_button_down_)
+                if(is_selecting_)
+                {
+                    const std::int64_t x = this->cell_of(event.motion.x + origin_x_);
+                    const std::int64_t y = this->cell_of(event.motion.y + origin_y_);
+                    this->selection_ = selection{std::min(x, select_from_x_), std::min(y, select_from_y_),
+                                                 std::max(x, select_from_x_) + 1,
+                                                 std::max(y, select_from_y_) + 1};
+                    this->is_window_changed_ = true;
+                }
+                else if(is_mouse_button_down_)
                 {
                     this->drag_x_ -= event.motion.x - mouse_prev_x_;
                     this->drag_y_ -= event.motion.y - mouse_prev_y_;
@@ -247,8 +457,6 @@ struct window
                         this->origin_y_ += drag_y_;
                         this->drag_x_ = 0;
                         this->drag_y_ = 0;
-
-                        this->expand_world();
                     }
                 }
                 mouse_prev_x_ = event.motion.x;
@@ -262,29 +470,110 @@ struct window
                     case SDL_SCANCODE_SPACE:
                     {
                         is_running_ = not is_running_;
+                        simulator_->set_running(is_running_);
                         break;
                     }
                     case SDL_SCANCODE_RETURN:
                     {
                         if(not is_running_)
                         {
-                            world_.update();
-                            this->draw();
+                            simulator_->step_once();
+                        }
+                        break;
+                    }
+                    case SDL_SCANCODE_UP:
+                    {
+                        if(steps_per_frame_ != 0 && steps_per_frame_ < max_steps_per_frame)
+                        {
+                            this->set_steps_per_frame(steps_per_frame_ * 2);
                         }
                         break;
                     }
+                    case SDL_SCANCODE_DOWN:
+                    {
+                        if(steps_per_frame_ > 1)
+                        {
+                            this->set_steps_per_frame(steps_per_frame_ / 2);
+                        }
+                        break;
+                    }
+                    case SDL_SCANCODE_F:
+                    {
+                        this->set_steps_per_frame(steps_per_frame_ == 0 ? 1 : 0);
+                        break;
+                    }
+                    case SDL_SCANCODE_LEFT:
+                    {
+                        this->pause();
+                        simulator_->rewind(this->seek_steps(event));
+                        break;
+                    }
+                    case SDL_SCANCODE_RIGHT:
+                    {
+                        this->pause();
+                        simulator_->forward(this->seek_steps(event));
+                        break;
+                    }
+                    case SDL_SCANCODE_HOME:
+                    {
+                        this->pause();
+                        simulator_->seek(0); // the oldest generation in the history
+                        break;
+                    }
+                    case SDL_SCANCODE_I:
+                    {
+                        this->is_overlay_shown_  = not is_overlay_shown_;
+                        this->is_window_changed_ = true;
+                        break;
+                    }
+                    case SDL_SCANCODE_C:
+                    {
+                        if(has_ctrl(event)) {this->copy_selection();}
+                        break;
+                    }
+                    case SDL_SCANCODE_X:
+                    {
+                        if(has_ctrl(event))
+                        {
+                            this->copy_selection();
+                            this->clear_selection();
+                        }
+                        break;
+                    }
+                    case SDL_SCANCODE_V:
+                    {
+                        if(has_ctrl(event)) {this->paste_clipboard();}
+                        break;
+                    }
+                    case SDL_SCANCODE_DELETE:
+                    case SDL_SCANCODE_BACKSPACE:
+                    {
+                        this->clear_selection();
+                        break;
+                    }
+                    case SDL_SCANCODE_ESCAPE:
+                    {
+                        this->selection_.reset();
+                        this->is_window_changed_ = true;
+                        break;
+                    }
+                    case SDL_SCANCODE_R:
+                    {
+                        this->clipboard_ = ((event.key.keysym.mod & KMOD_SHIFT) != 0) ?
+                            clipboard_.rotated_counterclockwise() : clipboard_.rotated_clockwise();
+                        break;
+                    }
+                    case SDL_SCANCODE_M:
+                    {
+                        this->clipboard_ = ((event.key.keysym.mod & KMOD_SHIFT) != 0) ?
+                            clipboard_.mirrored_vertically() : clipboard_.mirrored_horizontally();
+                        break;
+                    }
                     case SDL_SCANCODE_S:
                     {
-                        if((event.key.keysym.mod & KMOD_CTRL) != 0 ||
-                           (event.key.keysym.mod & 1024)      != 0) // Mac command-key
+                        if(has_ctrl(event))
                         {
-                            wad::write_archiver sink;
-                            wad::save<wad::type::map>(sink, "world", world_);
-                            sink.dump("haywire.msg");
-                            std::cerr << "status written into haywire.msg" << std::endl;
-//                             std::ofstream out("haywire.toml");
-//                             out << std::setw(160) << world_.into_toml();
-//                             std::cerr << "status written into haywire.toml" << std::endl;
+                            this->save_snapshot(timestamped_name("haywire"), false);
                         }
                         break;
                     }
@@ -298,45 +587,623 @@ struct window
 
     void load_toml(const std::string& fname)
     {
-        this->world_ = world(toml::parse(fname));
+        simulator_->replace(world(toml::parse(fname)));
+        return;
+    }
+
+    void load_snapshot(const std::string& fname)
+    {
+        simulator_->replace(read_snapshot(fname));
+        return;
+    }
+
+    void load_rle(const std::string& fname)
+    {
+        std::ifstream ifs(fname);
+        if(not ifs.good())
+        {
+            throw std::runtime_error("haywire::window::load_rle: file open error: " + fname);
+        }
+        world w(0, 0);
+        read_rle(ifs, w);
+        simulator_->replace(std::move(w));
+        return;
+    }
+    void load_mcl(const std::string& fname)
+    {
+        std::ifstream ifs(fname);
+        if(not ifs.good())
+        {
+            throw std::runtime_error("haywire::window::load_mcl: file open error: " + fname);
+        }
+        world w(0, 0);
+        read_mcl(ifs, w);
+        simulator_->replace(std::move(w));
+        return;
+    }
+
+    void set_num_threads(const std::size_t n)
+    {
+        simulator_->set_num_threads(n);
+        return;
+    }
+
+    void use_engine(const engine_kind kind)
+    {
+        simulator_->use_engine(kind);
+        return;
+    }
+
+    // saves the world every `interval` into haywire-autosave-*.hwb, if it is
+    // changed. The latest autosaves are kept. 0 disables it.
+    void set_autosave(const std::chrono::seconds interval)
+    {
+        this->autosave_interval_ = interval;
+        this->autosave_last_     = std::chrono::steady_clock::now();
         return;
     }
 
+    // prints the frame statistics into stderr once a second
+    void report_stats(const bool is_reported)
+    {
+        this->is_stats_reported_ = is_reported;
+        return;
+    }
+
+    // 0 means as fast as possible.
+    void set_steps_per_frame(const std::size_t n)
+    {
+        this->steps_per_frame_ = n;
+        simulator_->set_steps_per_frame(n);
+        return;
+    }
 
     template<typename Archiver>
     bool save(Archiver& arc) const
     {
-        return wad::save<wad::type::map>(arc, "world", world_);
+        return wad::save<wad::type::map>(arc, "world", simulator_->snapshot());
     }
     template<typename Archiver>
     bool load(Archiver& arc)
     {
-        return wad::load<wad::type::map>(arc, "world", world_);
+        world w(0, 0);
+        if(not wad::load<wad::type::map>(arc, "world", w))
+        {
+            return false;
+        }
+        simulator_->replace(std::move(w));
+        return true;
     }
 
   private:
 
+    using texture_resource_type =
+        std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)>;
+    using view_type = std::tuple<std::int64_t, std::int64_t, std::size_t, int, int, std::size_t>;
+
+    static constexpr inline std::size_t max_steps_per_frame = std::size_t(1) << 20;
+    static constexpr inline std::chrono::microseconds frame_interval{16667};
+    static constexpr inline int idle_timeout_ms = 250;
+    static constexpr inline std::size_t num_autosaves = 5;
+    static constexpr inline const char* autosave_prefix = "haywire-autosave";
+    static constexpr inline int overlay_scale   = 2;
+    static constexpr inline std::size_t max_lod = 16;
+
+    // [x0, x1) x [y0, y1) in the initial coordinates
+    struct selection
+    {
+        std::int64_t x0, y0, x1, y1;
+    };
+
+    // an edit sent to the simulator but not yet in the snapshot
+    struct edit
+    {
+        std::int64_t  x, y;
+        state         next;
+        std::uint64_t command;
+    };
+
+    static std::int64_t floor_div(const std::int64_t x, const std::int64_t d) noexcept
+    {
+        return (x >= 0) ? x / d : -((-x + d - 1) / d);
+    }
+
+    // the cell at a pixel and the pixel of a cell, in the initial coordinates.
+    // A zoomed-out pixel is represented by the left-top cell.
+    std::int64_t cell_of(const std::int64_t pixel) const noexcept
+    {
+        return floor_div(pixel, cell_size_) * (std::int64_t(1) << lod_);
+    }
+    std::int64_t pixel_of(const std::int64_t cell) const noexcept
+    {
+        return floor_div(cell * static_cast<std::int64_t>(cell_size_), std::int64_t(1) << lod_);
+    }
+
+    // state of a cell in the initial coordinates, including pending edits.
+    state cell_at(const std::int64_t x, const std::int64_t y) const noexcept
+    {
+        for(auto iter = pending_.rbegin(); iter != pending_.rend(); ++iter)
+        {
+            if(iter->x == x && iter->y == y)
+            {
+                return iter->next;
+            }
+        }
+        const world& snapshot = simulator_->snapshot();
+        const std::int64_t x_w = x + snapshot.origin_x();
+        const std::int64_t y_w = y + snapshot.origin_y();
+        if(x_w < 0 || static_cast<std::int64_t>(snapshot.width())  <= x_w ||
+           y_w < 0 || static_cast<std::int64_t>(snapshot.height()) <= y_w)
+        {
+            return state::vacuum;
+        }
+        return snapshot(static_cast<std::int32_t>(x_w), static_cast<std::int32_t>(y_w));
+    }
+
+    static Uint32 colour_of(const state s) noexcept
+    {
+        switch(s)
+        {
+            case state::vacuum: {return 0xFF000000u;}
+            case state::wire:   {return 0xFFFFFF00u;}
+            case state::head:   {return 0xFFFF0000u;}
+            case state::tail:   {return 0xFF0000FFu;}
+        }
+        return 0xFF000000u;
+    }
+
+    // writes cells in [begin, end) into the texture, chunk by chunk.
+    void write_cells(const world& w,
+                     const std::size_t begin_x, const std::size_t begin_y,
+                     const std::size_t end_x,   const std::size_t end_y)
+    {
+        void* pixels = nullptr;
+        int   pitch  = 0;
+        if(SDL_LockTexture(cells_texture_.get(), nullptr, &pixels, &pitch) != 0)
+        {
+            return;
+        }
+        const auto row = [pixels, pitch](const std::size_t y) noexcept {
+            return reinterpret_cast<Uint32*>(static_cast<char*>(pixels) + y * pitch);
+        };
+
+        // chunks are read in bands of `tile` rows, column by column in a
+        // band, so that the tiles of a tiled layout are read one by one.
+        constexpr std::size_t tile = world::layout_type::tile;
+        const std::size_t y_chk_end = (end_y + chunk::height - 1) / chunk::height;
+        for(std::size_t y_band = begin_y / chunk::height / tile * tile;
+            y_band < y_chk_end; y_band += tile)
+        {
+            const std::size_t y_chk_first = std::max(y_band, begin_y / chunk::height);
+            const std::size_t y_chk_last  = std::min(y_band + tile, y_chk_end);
+            for(std::size_t x_chk = begin_x / chunk::width;
+                x_chk * chunk::width < end_x; ++x_chk)
+            {
+                for(std::size_t y_chk = y_chk_first; y_chk < y_chk_last; ++y_chk)
+                {
+                    const auto& ch = w.chunk_at(x_chk, y_chk, std::nothrow);
+
+                    const std::size_t x0 = std::max(begin_x, x_chk * chunk::width);
+                    const std::size_t y0 = std::max(begin_y, y_chk * chunk::height);
+                    const std::size_t x1 = std::min(end_x, (x_chk + 1) * chunk::width);
+                    const std::size_t y1 = std::min(end_y, (y_chk + 1) * chunk::height);
+                    for(std::size_t y=y0; y<y1; ++y)
+                    {
+                        Uint32* dst = row(y - begin_y);
+                        for(std::size_t x=x0; x<x1; ++x)
+                        {
+                            dst[x - begin_x] = colour_of(ch(x % chunk::width, y % chunk::height));
+                        }
+                    }
+                }
+            }
+        }
+        SDL_UnlockTexture(cells_texture_.get());
+        return;
+    }
+
+    // writes only the dirty chunks in [begin, end) into the texture. If many
+    // chunks are dirty, it is faster to write all of them at once.
+    void write_dirty_cells(const world& w,
+                           const std::size_t begin_x, const std::size_t begin_y,
+                           const std::size_t end_x,   const std::size_t end_y)
+    {
+        dirty_chunks_.clear();
+        w.for_each_dirty_chunk([&](const std::size_t x_chk, const std::size_t y_chk) {
+            if(begin_x < (x_chk + 1) * chunk::width  && x_chk * chunk::width  < end_x &&
+               begin_y < (y_chk + 1) * chunk::height && y_chk * chunk::height < end_y)
+            {
+                dirty_chunks_.emplace_back(x_chk, y_chk);
+            }
+        });
+        const std::size_t area = (end_x - begin_x) * (end_y - begin_y);
+        if(area < dirty_chunks_.size() * chunk::width * chunk::height * 4)
+        {
+            this->write_cells(w, begin_x, begin_y, end_x, end_y);
+            return;
+        }
+
+        std::array<Uint32, chunk::width * chunk::height> pixels;
+        for(const auto& [x_chk, y_chk] : dirty_chunks_)
+        {
+            const auto& ch = w.chunk_at(x_chk, y_chk, std::nothrow);
+
+            const std::size_t x0 = std::max(begin_x, x_chk * chunk::width);
+            const std::size_t y0 = std::max(begin_y, y_chk * chunk::height);
+            const std::size_t x1 = std::min(end_x, (x_chk + 1) * chunk::width);
+            const std::size_t y1 = std::min(end_y, (y_chk + 1) * chunk::height);
+            for(std::size_t y=y0; y<y1; ++y)
+            {
+                for(std::size_t x=x0; x<x1; ++x)
+                {
+                    pixels[(y - y0) * (x1 - x0) + (x - x0)] =
+                        colour_of(ch(x % chunk::width, y % chunk::height));
+                }
+            }
+            const SDL_Rect rect{static_cast<int>(x0 - begin_x), static_cast<int>(y0 - begin_y),
+                                static_cast<int>(x1 - x0),      static_cast<int>(y1 - y0)};
+            SDL_UpdateTexture(cells_texture_.get(), &rect, pixels.data(),
+                              static_cast<int>((x1 - x0) * sizeof(Uint32)));
+        }
+        return;
+    }
+
+    // writes the window zoomed out. A pixel shows 2^lod_ x 2^lod_ cells in
+    // the colour of the most active state in them: head, tail and wire in
+    // this order. Blocks of chunks are read from the overview of the world at
+    // the level of the same size, and smaller blocks from the cells.
+    void write_overview(const world& w, const int window_width, const int window_height)
+    {
+        static_assert(chunk::width == chunk::height && (chunk::width & (chunk::width - 1)) == 0);
+        constexpr std::size_t chunk_lod = [] {
+            std::size_t n = 0;
+            while((std::size_t(1) << n) < chunk::width) {++n;}
+            return n;
+        }();
+
+        void* pixels = nullptr;
+        int   pitch  = 0;
+        if(SDL_LockTexture(cells_texture_.get(), nullptr, &pixels, &pitch) != 0)
+        {
+            return;
+        }
+        const auto colour = [](const state_mask m) noexcept {
+            return (m & (1u << state::head)) ? colour_of(state::head) :
+                   (m & (1u << state::tail)) ? colour_of(state::tail) :
+                   (m & (1u << state::wire)) ? colour_of(state::wire) : colour_of(state::vacuum);
+        };
+        const std::int64_t block   = std::int64_t(1) << lod_;
+        const std::int64_t width   = w.width();
+        const std::int64_t height  = w.height();
+        const std::int64_t shift_x = w.overview_offset_x() * chunk::width;
+        const std::int64_t shift_y = w.overview_offset_y() * chunk::height;
+        for(int y=0; y<window_height; ++y)
+        {
+            Uint32* dst = reinterpret_cast<Uint32*>(static_cast<char*>(pixels) + y * pitch);
+            const std::int64_t y_w = this->cell_of(origin_y_ + y) + w.origin_y();
+            for(int x=0; x<window_width; ++x)
+            {
+                const std::int64_t x_w = this->cell_of(origin_x_ + x) + w.origin_x();
+                if(x_w + block <= 0 || width <= x_w || y_w + block <= 0 || height <= y_w)
+                {
+                    dst[x] = colour_of(state::vacuum);
+                    continue;
+                }
+                if(chunk_lod <= lod_)
+                {
+                    // blocks are aligned to the overview, not to the window
+                    const std::size_t level = lod_ - chunk_lod;
+                    dst[x] = colour(w.overview(level,
+                        std::max<std::int64_t>(x_w + shift_x, 0) >> lod_,
+                        std::max<std::int64_t>(y_w + shift_y, 0) >> lod_));
+                    continue;
+                }
+                state_mask m = 0;
+                for(std::int64_t j=std::max<std::int64_t>(y_w, 0); j<std::min(y_w + block, height); ++j)
+                {
+                    for(std::int64_t i=std::max<std::int64_t>(x_w, 0); i<std::min(x_w + block, width); ++i)
+                    {
+                        m |= 1u << w(static_cast<std::int32_t>(i), static_cast<std::int32_t>(j));
+                    }
+                }
+                dst[x] = colour(m);
+            }
+        }
+        SDL_UnlockTexture(cells_texture_.get());
+        return;
+    }
+
+    // overlays black borders of cells. The grid is re-generated only when the
+    // size of cells or the window changes.
+    void draw_grid(const int texture_width, const int texture_height, const SDL_Rect& dst)
+    {
+        const int width  = texture_width  * cell_size_;
+        const int height = texture_height * cell_size_;
+        if(not grid_texture_ || grid_cell_size_ != cell_size_ ||
+           grid_width_ != width || grid_height_ != height)
+        {
+            this->grid_texture_ = texture_resource_type(SDL_CreateTexture(
+                renderer_.get(), SDL_PIXELFORMAT_ARGB8888,
+                SDL_TEXTUREACCESS_STATIC, width, height), &SDL_DestroyTexture);
+            SDL_SetTextureBlendMode(grid_texture_.get(), SDL_BLENDMODE_BLEND);
+
+            std::vector<Uint32> pixels(static_cast<std::size_t>(width) * height);
+            for(int y=0; y<height; ++y)
+            {
+                const int y_rem = y % cell_size_;
+                const bool is_border_y = (y_rem == 0 || y_rem + 1 == static_cast<int>(cell_size_));
+                for(int x=0; x<width; ++x)
+                {
+                    const int x_rem = x % cell_size_;
+                    const bool is_border = is_border_y ||
+                        x_rem == 0 || x_rem + 1 == static_cast<int>(cell_size_);
+                    pixels[static_cast<std::size_t>(y) * width + x] =
+                        is_border ? 0xFF000000u : 0x00000000u;
+                }
+            }
+            SDL_UpdateTexture(grid_texture_.get(), nullptr, pixels.data(),
+                              width * sizeof(Uint32));
+            this->grid_cell_size_ = cell_size_;
+            this->grid_width_     = width;
+            this->grid_height_    = height;
+        }
+        const SDL_Rect src{0, 0, dst.w, dst.h};
+        SDL_RenderCopy(renderer_.get(), grid_texture_.get(), &src, &dst);
+        return;
+    }
+
+    // requests the simulator to expand the world to cover the window. The
+    // request is sent until the snapshot covers the window.
     void expand_world()
     {
+        if(lod_ != 0) // a zoomed-out view shows the world as it is
+        {
+            return;
+        }
         const auto [window_width, window_height] = this->window_size();
+        const std::int64_t x0 = this->cell_of(origin_x_);
+        const std::int64_t y0 = this->cell_of(origin_y_);
+        const std::int64_t x1 = this->cell_of(origin_x_ + window_width)  + 1;
+        const std::int64_t y1 = this->cell_of(origin_y_ + window_height) + 1;
 
-        while(origin_x_ < 0)
+        const world& snapshot = simulator_->snapshot();
+        if(x0 + snapshot.origin_x() < 0 || y0 + snapshot.origin_y() < 0 ||
+           static_cast<std::int64_t>(snapshot.width())  < x1 + snapshot.origin_x() ||
+           static_cast<std::int64_t>(snapshot.height()) < y1 + snapshot.origin_y())
         {
-            world_.expand_width(world::direction::minus);
-            this->origin_x_ += chunk::width * cell_size_;
+            simulator_->cover(x0, y0, x1, y1);
         }
-        while(world_.width() * cell_size_ <= origin_x_ + window_width)
+        return;
+    }
+
+    void acquire_snapshot()
+    {
+        if(simulator_->acquire())
         {
-            world_.expand_width(world::direction::plus);
+            this->is_world_changed_ = true;
+
+            // dirty chunks are relative to the previous snapshot
+            const auto number = simulator_->snapshot_number();
+            if(number != snapshot_number_ + 1 || simulator_->snapshot().is_all_dirty())
+            {
+                this->needs_full_repaint_ = true;
+            }
+            this->snapshot_number_ = number;
+
+            // edits already applied to the snapshot are not pending anymore
+            const auto applied = simulator_->snapshot_commands();
+            pending_.erase(std::remove_if(pending_.begin(), pending_.end(),
+                [applied](const edit& e) noexcept {return e.command <= applied;}),
+                pending_.end());
         }
-        while(origin_y_ < 0)
+        return;
+    }
+
+    // the simulation thread packs the world and the saver writes it, so
+    // the frame does not wait for the disk.
+    void save_snapshot(std::string fname, const bool is_autosave)
+    {
+        background_saver* saver = saver_.get();
+        simulator_->take_snapshot(
+            [saver, fname = std::move(fname), is_autosave](std::shared_ptr<const packed_world> w) {
+                if(is_autosave)
+                {
+                    saver->autosave(std::move(w), fname);
+                }
+                else
+                {
+                    saver->save(std::move(w), fname);
+                }
+            });
+        return;
+    }
+
+    void autosave()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if(autosave_interval_.count() == 0 || now - autosave_last_ < autosave_interval_)
         {
-            world_.expand_height(world::direction::minus);
-            this->origin_y_ += chunk::height * cell_size_;
+            return;
         }
-        while(world_.height() * cell_size_ <= origin_y_ + window_height)
+        this->autosave_last_ = now;
+        if(simulator_->snapshot_number() != autosave_number_)
         {
-            world_.expand_height(world::direction::plus);
+            this->autosave_number_ = simulator_->snapshot_number();
+            this->save_snapshot(timestamped_name(autosave_prefix), true);
+        }
+        return;
+    }
+
+    static void report_saved(const std::string& fname, const std::string& error)
+    {
+        if(error.empty())
+        {
+            std::cerr << "status written into " << fname << std::endl;
+        }
+        else
+        {
+            std::cerr << "failed to save " << fname << ": " << error << std::endl;
+        }
+        return;
+    }
+
+    // Ctrl, or the command key on Mac
+    static bool has_ctrl(const SDL_Event& event) noexcept
+    {
+        return (event.key.keysym.mod & KMOD_CTRL) != 0 ||
+               (event.key.keysym.mod & KMOD_GUI)  != 0;
+    }
+
+    // copies the selected cells in the snapshot into the clipboard
+    void copy_selection()
+    {
+        if(not selection_)
+        {
+            return;
+        }
+        const world& snapshot = simulator_->snapshot();
+        const auto ox = snapshot.origin_x();
+        const auto oy = snapshot.origin_y();
+        this->clipboard_ = snapshot.copy(selection_->x0 + ox, selection_->y0 + oy,
+                                         selection_->x1 + ox, selection_->y1 + oy);
+        return;
+    }
+    void clear_selection()
+    {
+        if(selection_)
+        {
+            simulator_->fill(selection_->x0, selection_->y0,
+                             selection_->x1, selection_->y1, state::vacuum);
+        }
+        return;
+    }
+    // the left-top corner of the pattern is put at the mouse cursor
+    void paste_clipboard()
+    {
+        if(clipboard_.empty())
+        {
+            return;
+        }
+        int mouse_x, mouse_y;
+        SDL_GetMouseState(&mouse_x, &mouse_y);
+        const std::int64_t x = this->cell_of(mouse_x + origin_x_);
+        const std::int64_t y = this->cell_of(mouse_y + origin_y_);
+        simulator_->paste(clipboard_, x, y);
+        this->selection_ = selection{x, y, x + static_cast<std::int64_t>(clipboard_.width()),
+                                           y + static_cast<std::int64_t>(clipboard_.height())};
+        return;
+    }
+
+    void draw_selection()
+    {
+        const std::int64_t x0 = this->pixel_of(selection_->x0);
+        const std::int64_t y0 = this->pixel_of(selection_->y0);
+        const SDL_Rect rect{static_cast<int>(x0 - origin_x_), static_cast<int>(y0 - origin_y_),
+            static_cast<int>(std::max<std::int64_t>(this->pixel_of(selection_->x1) - x0, 1)),
+            static_cast<int>(std::max<std::int64_t>(this->pixel_of(selection_->y1) - y0, 1))};
+        SDL_SetRenderDrawColor(renderer_.get(), 0x00, 0xFF, 0x00, 0xFF);
+        SDL_RenderDrawRect(renderer_.get(), &rect);
+        return;
+    }
+
+    void pause()
+    {
+        if(is_running_)
+        {
+            this->is_running_ = false;
+            simulator_->set_running(false);
+        }
+        return;
+    }
+
+    // Shift moves 100 generations at once
+    static std::uint64_t seek_steps(const SDL_Event& event) noexcept
+    {
+        return (event.key.keysym.mod & KMOD_SHIFT) != 0 ? 100 : 1;
+    }
+
+    // nothing changes until an event arrives
+    bool is_idle() const
+    {
+        return not is_running_ && not is_world_changed_ && not is_window_changed_ &&
+               simulator_->snapshot_commands() == simulator_->num_commands();
+    }
+
+    // the left-top corner of the window in pixels of the snapshot. It may be
+    // outside of the snapshot until the expansion is published.
+    view_type current_view()
+    {
+        const world& snapshot = simulator_->snapshot();
+        const auto [window_width, window_height] = this->window_size();
+        const std::int64_t cell = cell_size_;
+        return view_type{origin_x_ + snapshot.origin_x() * cell,
+                         origin_y_ + snapshot.origin_y() * cell,
+                         cell_size_, window_width, window_height, lod_};
+    }
+
+    // shows the statistics of the snapshot and the frames at the left-top
+    // corner. The frame statistics are updated once a second.
+    void draw_overlay()
+    {
+        const world& snapshot = simulator_->snapshot();
+        const auto   stats    = snapshot.statistics();
+
+        const auto fixed = [](const double x, const int precision) {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(precision) << x;
+            return oss.str();
+        };
+        const std::vector<std::string> lines = {
+            "GEN " + std::to_string(simulator_->snapshot_generation()) + "  " +
+                std::to_string(static_cast<std::size_t>(simulator_->rate())) + " GENS/S",
+            simulator_->snapshot_period() == 0 ? std::string("PERIOD -") :
+                "PERIOD " + std::to_string(simulator_->snapshot_period()) + "  PHASE " +
+                std::to_string(simulator_->snapshot_phase()),
+            "HEADS " + std::to_string(stats.num_heads) + "  TAILS " +
+                std::to_string(stats.num_tails) + "  WIRES " + std::to_string(stats.num_wires),
+            "WORLD " + std::to_string(stats.width) + "X" + std::to_string(stats.height) +
+                "  ACTIVE CHUNKS " + std::to_string(stats.num_active_chunks),
+            lod_ == 0 ? "PIXELS/CELL " + std::to_string(cell_size_) :
+                "CELLS/PIXEL " + std::to_string(std::size_t(1) << lod_) + "X" +
+                std::to_string(std::size_t(1) << lod_),
+            "MEMORY " + fixed(stats.memory / (1024.0 * 1024.0), 1) + " MIB  UPDATE " +
+                fixed(stats.update_seconds * 1000.0, 2) + " MS",
+            "FRAME " + fixed(summary_.mean_frame_ms, 2) + " MS  EVENT " +
+                fixed(summary_.mean_event_ms, 2) + " MS  DRAW " +
+                fixed(summary_.mean_draw_ms, 2) + " MS",
+            fixed(summary_.draws_per_sec, 1) + " FPS  GUI CPU " +
+                fixed(summary_.cpu_percent, 1) + "%",
+        };
+        draw_text_box(renderer_.get(), 4, 4, overlay_scale, lines);
+        return;
+    }
+
+    // shows the speed of the simulation and the GUI once a second
+    void update_title()
+    {
+        if(not stats_.is_ready())
+        {
+            return;
+        }
+        const auto summary = stats_.summarize();
+        this->summary_ = summary;
+        if(this->is_overlay_shown_)
+        {
+            this->is_window_changed_ = true; // redraw the new summary
+        }
+
+        std::ostringstream oss;
+        oss << "haywire - " << static_cast<std::size_t>(simulator_->rate()) << " gens/sec (";
+        if(steps_per_frame_ == 0) {oss << "max";}
+        else                      {oss << steps_per_frame_ << " steps/frame";}
+        oss << ") | " << std::fixed << std::setprecision(1) << summary.draws_per_sec
+            << " fps, " << std::setprecision(2) << summary.mean_frame_ms << " ms/frame (max "
+            << summary.max_frame_ms << "), GUI CPU " << std::setprecision(1)
+            << summary.cpu_percent << "%";
+        SDL_SetWindowTitle(window_.get(), oss.str().c_str());
+        if(is_stats_reported_)
+        {
+            std::cerr << oss.str().substr(10) << std::endl;
         }
         return;
     }
@@ -353,14 +1220,44 @@ struct window
     bool is_mouse_button_down_ = false;
     bool is_mouse_dragging_    = false;
     bool is_running_           = true;
+    std::size_t steps_per_frame_ = 1;
     std::int32_t drag_x_ = 0,   drag_y_ = 0;
     std::int32_t mouse_prev_x_, mouse_prev_y_;
-    std::int32_t origin_x_, origin_y_;
+    std::int32_t origin_x_, origin_y_; // in pixels of the initial coordinates
     std::size_t            cell_size_;
-    world                  world_;
+    std::size_t            lod_ = 0; // a pixel shows 2^lod_ x 2^lod_ cells if cell_size_ is 1
+    std::unique_ptr<background_saver> saver_; // outlives the simulator
+    std::unique_ptr<simulator> simulator_;
+    std::vector<edit>      pending_;
     sdl_resource_type      resource_;
     window_resource_type   window_;
     renderer_resource_type renderer_;
+
+    bool                   is_world_changed_  = true;
+    bool                   needs_full_repaint_ = true;
+    std::uint64_t          snapshot_number_   = 0;
+    std::vector<std::pair<std::size_t, std::size_t>> dirty_chunks_;
+    bool                   is_window_changed_ = true;
+    bool                   is_stats_reported_ = false;
+    bool                   is_overlay_shown_  = false;
+    bool                   is_selecting_      = false;
+    std::int64_t           select_from_x_     = 0;
+    std::int64_t           select_from_y_     = 0;
+    std::optional<selection> selection_;
+    pattern                clipboard_;
+    frame_stats            stats_;
+    frame_stats::summary   summary_{};
+    std::chrono::seconds   autosave_interval_{0};
+    std::chrono::steady_clock::time_point autosave_last_ = std::chrono::steady_clock::now();
+    std::uint64_t          autosave_number_ = 0; // snapshot autosaved last
+    view_type              texture_view_{0, 0, 0, 0, 0, 0};
+    texture_resource_type  cells_texture_{nullptr, &SDL_DestroyTexture};
+    int                    cells_texture_width_  = 0;
+    int                    cells_texture_height_ = 0;
+    texture_resource_type  grid_texture_{nullptr, &SDL_DestroyTexture};
+    std::size_t            grid_cell_size_ = 0;
+    int                    grid_width_     = 0;
+    int                    grid_height_    = 0;
 };
 
 
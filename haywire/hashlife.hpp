@@ -0,0 +1,598 @@
+#ifndef HAYWIRE_HASHLIFE_HPP
+#define HAYWIRE_HASHLIFE_HPP
+#include "world.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+namespace haywire
+{
+
+// HashLife engine. The world is represented as a quadtree whose leaves are
+// chunks. Identical subtrees are shared through a hash-consing table, and the
+// result of advancing a node by 2^j generations is memoized, so that periodic
+// circuits can be advanced exponentially fast.
+//
+// The node cache is bounded. When it grows beyond the limit, nodes that are
+// not used recently are discarded together with their memoized results.
+struct hashlife_engine
+{
+    using node_id = std::uint32_t;
+    static constexpr inline node_id     npos       = 0xFFFFFFFFu;
+    static constexpr inline std::size_t leaf_level = 3; // 8x8 cells
+    static constexpr inline std::size_t base_level = 4; // brute-forced
+
+    static_assert(chunk::width == 8 && chunk::height == 8,
+                  "hashlife_engine uses a chunk as a leaf of 8x8 cells");
+
+    explicit hashlife_engine(const world& w,
+                             const std::size_t cache_limit = std::size_t(1) << 22)
+        : width_(w.width()), height_(w.height()), generation_(0),
+          origin_x_(0), origin_y_(0), clock_(0),
+          cache_limit_(std::max<std::size_t>(cache_limit, 1024))
+    {
+        std::size_t level = base_level;
+        while((std::size_t(1) << level) < std::max(width_, height_))
+        {
+            level += 1;
+        }
+        root_ = this->build(w, level, 0, 0);
+    }
+
+    void update() {this->step(1); return;}
+
+    // advances n generations.
+    void step(const std::uint64_t n)
+    {
+        for(std::size_t j=0; j<64; ++j)
+        {
+            if((n >> j) & 1u)
+            {
+                this->advance(j);
+            }
+        }
+        return;
+    }
+
+    // advances to generation g. It cannot go back.
+    void jump_to(const std::uint64_t g)
+    {
+        if(g < generation_)
+        {
+            throw std::invalid_argument("hashlife_engine::jump_to: generation " +
+                std::to_string(g) + " is already passed (current generation is " +
+                std::to_string(generation_) + ")");
+        }
+        this->step(g - generation_);
+        return;
+    }
+
+    std::uint64_t generation() const noexcept {return generation_;}
+
+    void store(world& w) const
+    {
+        assert(w.width() == width_ && w.height() == height_);
+
+        const std::size_t width_chunk  = width_  / chunk::width;
+        const std::size_t height_chunk = height_ / chunk::height;
+        for(std::size_t y_chk=0; y_chk<height_chunk; ++y_chk)
+        {
+            for(std::size_t x_chk=0; x_chk<width_chunk; ++x_chk)
+            {
+                const auto leaf = this->find_leaf(
+                        static_cast<std::int64_t>(x_chk * chunk::width),
+                        static_cast<std::int64_t>(y_chk * chunk::height));
+
+                const auto& self = std::as_const(w).chunk_at(x_chk, y_chk, std::nothrow);
+                const auto& next = (leaf == npos) ? chunk{} : leaves_[nodes_[leaf].child[0]];
+                if(self.cells != next.cells)
+                {
+                    w.chunk_at(x_chk, y_chk, std::nothrow) = next;
+                }
+            }
+        }
+        return;
+    }
+
+    state operator()(const std::int64_t x, const std::int64_t y) const noexcept
+    {
+        const auto leaf = this->find_leaf(x, y);
+        if(leaf == npos) {return state::vacuum;}
+
+        const auto& ch = leaves_[nodes_[leaf].child[0]];
+        return ch((x - origin_x_) % chunk::width, (y - origin_y_) % chunk::height);
+    }
+
+    std::size_t width()  const noexcept {return width_ ;}
+    std::size_t height() const noexcept {return height_;}
+
+    std::size_t cache_size()  const noexcept {return nodes_.size();}
+    std::size_t cache_limit() const noexcept {return cache_limit_;}
+
+  private:
+
+    struct node
+    {
+        std::uint8_t  level;
+        node_id       child[4]; // nw, ne, sw, se. leaf: index of leaves_
+        node_id       result;   // advanced by 2^(level-2) generations
+        std::uint64_t last_used;
+    };
+
+    struct leaf_hasher
+    {
+        std::size_t operator()(const chunk& ch) const noexcept
+        {
+            std::uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+            for(const auto s : ch.cells)
+            {
+                h ^= static_cast<std::uint8_t>(s);
+                h *= 0x100000001b3ull;
+            }
+            return static_cast<std::size_t>(h);
+        }
+    };
+    struct leaf_equal
+    {
+        bool operator()(const chunk& lhs, const chunk& rhs) const noexcept
+        {
+            return lhs.cells == rhs.cells;
+        }
+    };
+    using children_type = std::array<node_id, 4>;
+    struct children_hasher
+    {
+        std::size_t operator()(const children_type& c) const noexcept
+        {
+            std::uint64_t h = 0;
+            for(const auto id : c)
+            {
+                h = (h ^ id) * 0x9E3779B97F4A7C15ull;
+                h ^= h >> 29;
+            }
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+  private:
+
+    // ------------------------------------------------------------------------
+    // construction of nodes
+
+    node_id leaf(const chunk& ch)
+    {
+        const auto found = leaf_table_.find(ch);
+        if(found != leaf_table_.end())
+        {
+            nodes_[found->second].last_used = ++clock_;
+            return found->second;
+        }
+        const node_id id = static_cast<node_id>(nodes_.size());
+        nodes_.push_back(node{leaf_level,
+                {static_cast<node_id>(leaves_.size()), npos, npos, npos},
+                npos, ++clock_});
+        leaves_.push_back(ch);
+        leaf_table_.emplace(ch, id);
+        return id;
+    }
+
+    node_id make(const node_id nw, const node_id ne, const node_id sw, const node_id se)
+    {
+        const children_type key{{nw, ne, sw, se}};
+        const auto found = table_.find(key);
+        if(found != table_.end())
+        {
+            nodes_[found->second].last_used = ++clock_;
+            return found->second;
+        }
+        const node_id id = static_cast<node_id>(nodes_.size());
+        nodes_.push_back(node{static_cast<std::uint8_t>(nodes_[nw].level + 1),
+                              {nw, ne, sw, se}, npos, ++clock_});
+        table_.emplace(key, id);
+        return id;
+    }
+
+    node_id empty(const std::size_t level)
+    {
+        if(empty_.size() <= level) {empty_.resize(level + 1, npos);}
+        if(empty_[level] == npos)
+        {
+            if(level == leaf_level)
+            {
+                empty_[level] = this->leaf(chunk{});
+            }
+            else
+            {
+                const auto e = this->empty(level - 1);
+                empty_[level] = this->make(e, e, e, e);
+            }
+        }
+        return empty_[level];
+    }
+
+    node_id build(const world& w, const std::size_t level,
+                  const std::size_t x0, const std::size_t y0)
+    {
+        if(width_ <= x0 || height_ <= y0)
+        {
+            return this->empty(level);
+        }
+        if(level == leaf_level)
+        {
+            return this->leaf(w.chunk_at(x0 / chunk::width, y0 / chunk::height,
+                                         std::nothrow));
+        }
+        const std::size_t half = std::size_t(1) << (level - 1);
+        const auto nw = this->build(w, level - 1, x0,        y0);
+        const auto ne = this->build(w, level - 1, x0 + half, y0);
+        const auto sw = this->build(w, level - 1, x0,        y0 + half);
+        const auto se = this->build(w, level - 1, x0 + half, y0 + half);
+        return this->make(nw, ne, sw, se);
+    }
+
+    node_id child(const node_id n, const std::size_t i) const noexcept
+    {
+        return nodes_[n].child[i];
+    }
+    std::size_t level(const node_id n) const noexcept
+    {
+        return nodes_[n].level;
+    }
+
+    // the central half of a node.
+    node_id centre(const node_id n)
+    {
+        if(this->level(n) == base_level)
+        {
+            chunk ch;
+            for(std::size_t y=0; y<chunk::height; ++y)
+            {
+                for(std::size_t x=0; x<chunk::width; ++x)
+                {
+                    ch(x, y) = this->cell_of_base(n, x + 4, y + 4);
+                }
+            }
+            return this->leaf(ch);
+        }
+        const auto nw = child(n, 0), ne = child(n, 1), sw = child(n, 2), se = child(n, 3);
+        return this->make(child(nw, 3), child(ne, 2), child(sw, 1), child(se, 0));
+    }
+
+    state cell_of_base(const node_id n, const std::size_t x, const std::size_t y) const noexcept
+    {
+        const auto quad = child(n, (y < 8 ? 0 : 2) + (x < 8 ? 0 : 1));
+        return leaves_[child(quad, 0)](x % 8, y % 8);
+    }
+
+    // ------------------------------------------------------------------------
+    // time evolution
+
+    // advances a node of level k by 2^j generations (j <= k-2) and returns
+    // its central part, a node of level k-1.
+    node_id result(const node_id n, const std::size_t j)
+    {
+        const std::size_t k = this->level(n);
+        assert(base_level <= k && j + 2 <= k);
+
+        nodes_[n].last_used = ++clock_;
+        if(j + 2 == k && nodes_[n].result != npos)
+        {
+            return nodes_[n].result;
+        }
+        const std::uint64_t memo_key = (std::uint64_t(n) << 8) | j;
+        if(j + 2 != k)
+        {
+            const auto found = memo_.find(memo_key);
+            if(found != memo_.end()) {return found->second;}
+        }
+
+        node_id r = npos;
+        if(k == base_level)
+        {
+            r = this->result_base(n, j);
+        }
+        else
+        {
+            const auto nw = child(n, 0), ne = child(n, 1), sw = child(n, 2), se = child(n, 3);
+
+            // 9 overlapping sub-nodes of level k-1
+            std::array<node_id, 9> sub = {{
+                nw,
+                this->make(child(nw, 1), child(ne, 0), child(nw, 3), child(ne, 2)),
+                ne,
+                this->make(child(nw, 2), child(nw, 3), child(sw, 0), child(sw, 1)),
+                this->make(child(nw, 3), child(ne, 2), child(sw, 1), child(se, 0)),
+                this->make(child(ne, 2), child(ne, 3), child(se, 0), child(se, 1)),
+                sw,
+                this->make(child(sw, 1), child(se, 0), child(sw, 3), child(se, 2)),
+                se
+            }};
+            for(auto& s : sub)
+            {
+                s = (j + 2 == k) ? this->result(s, k - 3) : this->centre(s);
+            }
+            const auto q00 = this->make(sub[0], sub[1], sub[3], sub[4]);
+            const auto q01 = this->make(sub[1], sub[2], sub[4], sub[5]);
+            const auto q10 = this->make(sub[3], sub[4], sub[6], sub[7]);
+            const auto q11 = this->make(sub[4], sub[5], sub[7], sub[8]);
+
+            const std::size_t jj = (j + 2 == k) ? k - 3 : j;
+            const auto r00 = this->result(q00, jj);
+            const auto r01 = this->result(q01, jj);
+            const auto r10 = this->result(q10, jj);
+            const auto r11 = this->result(q11, jj);
+            r = this->make(r00, r01, r10, r11);
+        }
+
+        if(j + 2 == k)
+        {
+            nodes_[n].result = r;
+        }
+        else
+        {
+            memo_.emplace(memo_key, r);
+        }
+        return r;
+    }
+
+    // brute-force a node of 16x16 cells.
+    node_id result_base(const node_id n, const std::size_t j)
+    {
+        constexpr std::int32_t size = 16;
+        std::array<state, size * size> cells, next;
+        for(std::int32_t y=0; y<size; ++y)
+        {
+            for(std::int32_t x=0; x<size; ++x)
+            {
+                cells[y * size + x] = this->cell_of_base(n, x, y);
+            }
+        }
+        const auto at = [&cells](const std::int32_t x, const std::int32_t y) noexcept {
+            if(x < 0 || size <= x || y < 0 || size <= y) {return state::vacuum;}
+            return cells[y * size + x];
+        };
+        for(std::size_t t=0; t < (std::size_t(1) << j); ++t)
+        {
+            for(std::int32_t y=0; y<size; ++y)
+            {
+                for(std::int32_t x=0; x<size; ++x)
+                {
+                    auto& s = next[y * size + x];
+                    switch(at(x, y))
+                    {
+                        case state::vacuum: {s = state::vacuum; break;}
+                        case state::head:   {s = state::tail;   break;}
+                        case state::tail:   {s = state::wire;   break;}
+                        case state::wire:
+                        {
+                            int count = 0;
+                            for(std::int32_t dy=-1; dy<=1; ++dy)
+                            {
+                                for(std::int32_t dx=-1; dx<=1; ++dx)
+                                {
+                                    count += static_cast<int>(at(x+dx, y+dy) == state::head);
+                                }
+                            }
+                            s = (count == 1 || count == 2) ? state::head : state::wire;
+                            break;
+                        }
+                    }
+                }
+            }
+            cells = next;
+        }
+        chunk ch;
+        for(std::size_t y=0; y<chunk::height; ++y)
+        {
+            for(std::size_t x=0; x<chunk::width; ++x)
+            {
+                ch(x, y) = cells[(y + 4) * size + (x + 4)];
+            }
+        }
+        return this->leaf(ch);
+    }
+
+    // advances the whole world by 2^j generations.
+    void advance(const std::size_t j)
+    {
+        // the pattern must be in the central half of a node of level >= j+2.
+        // Wireworld patterns never grow, so padding with vacuum is enough.
+        this->expand_root();
+        while(this->level(root_) < j + 2)
+        {
+            this->expand_root();
+        }
+        const std::int64_t quarter = std::int64_t(1) << (this->level(root_) - 2);
+        root_ = this->result(root_, j);
+        origin_x_ += quarter;
+        origin_y_ += quarter;
+        generation_ += std::uint64_t(1) << j;
+
+        this->shrink_root();
+        if(cache_limit_ < nodes_.size())
+        {
+            this->collect();
+        }
+        return;
+    }
+
+    void expand_root()
+    {
+        const std::size_t k = this->level(root_);
+        const auto e  = this->empty(k - 1);
+        const auto nw = child(root_, 0), ne = child(root_, 1),
+                   sw = child(root_, 2), se = child(root_, 3);
+        root_ = this->make(this->make(e, e, e, nw), this->make(e, e, ne, e),
+                           this->make(e, sw, e, e), this->make(se, e, e, e));
+        origin_x_ -= std::int64_t(1) << (k - 1);
+        origin_y_ -= std::int64_t(1) << (k - 1);
+        return;
+    }
+
+    // removes an empty border to keep the root small
+    void shrink_root()
+    {
+        while(base_level < this->level(root_))
+        {
+            const std::size_t k = this->level(root_);
+            const auto e = this->empty(k - 2);
+            const auto nw = child(root_, 0), ne = child(root_, 1),
+                       sw = child(root_, 2), se = child(root_, 3);
+            const bool is_border_empty =
+                child(nw, 0) == e && child(nw, 1) == e && child(nw, 2) == e &&
+                child(ne, 0) == e && child(ne, 1) == e && child(ne, 3) == e &&
+                child(sw, 0) == e && child(sw, 2) == e && child(sw, 3) == e &&
+                child(se, 1) == e && child(se, 2) == e && child(se, 3) == e;
+            if(not is_border_empty) {break;}
+
+            root_ = this->centre(root_);
+            origin_x_ += std::int64_t(1) << (k - 2);
+            origin_y_ += std::int64_t(1) << (k - 2);
+        }
+        return;
+    }
+
+    // returns the leaf that contains (x, y), or npos if it is out of the root.
+    node_id find_leaf(std::int64_t x, std::int64_t y) const noexcept
+    {
+        x -= origin_x_;
+        y -= origin_y_;
+        std::size_t k = this->level(root_);
+        if(x < 0 || y < 0 || (std::int64_t(1) << k) <= x || (std::int64_t(1) << k) <= y)
+        {
+            return npos;
+        }
+        node_id n = root_;
+        while(leaf_level < k)
+        {
+            const std::int64_t half = std::int64_t(1) << (k - 1);
+            const std::size_t  idx  = (y < half ? 0 : 2) + (x < half ? 0 : 1);
+            n = child(n, idx);
+            x %= half;
+            y %= half;
+            k -= 1;
+        }
+        return n;
+    }
+
+    // ------------------------------------------------------------------------
+    // cache management
+
+    // discards the least recently used nodes. The root and the nodes that
+    // are reachable from kept nodes are always kept.
+    void collect()
+    {
+        const std::size_t num = nodes_.size();
+
+        std::vector<std::uint64_t> stamps(num);
+        std::transform(nodes_.begin(), nodes_.end(), stamps.begin(),
+                       [](const node& n) noexcept {return n.last_used;});
+        const std::size_t keep_recent = cache_limit_ / 2;
+        const auto nth = stamps.begin() + (num - std::min(num, keep_recent));
+        std::nth_element(stamps.begin(), nth, stamps.end());
+        const std::uint64_t threshold = (nth == stamps.end()) ? clock_ + 1 : *nth;
+
+        std::vector<std::uint8_t> keep(num, 0);
+        for(std::size_t i=0; i<num; ++i)
+        {
+            keep[i] = (threshold <= nodes_[i].last_used);
+        }
+        keep[root_] = 1;
+        for(const auto e : empty_)
+        {
+            if(e != npos) {keep[e] = 1;}
+        }
+        // children always have smaller indices than their parents
+        for(std::size_t i=num; i-- > 0;)
+        {
+            if(keep[i] && leaf_level < nodes_[i].level)
+            {
+                for(const auto c : nodes_[i].child) {keep[c] = 1;}
+            }
+        }
+
+        std::vector<node_id> new_id(num, npos);
+        std::vector<node>    nodes;
+        std::vector<chunk>   leaves;
+        for(std::size_t i=0; i<num; ++i)
+        {
+            if(not keep[i]) {continue;}
+            new_id[i] = static_cast<node_id>(nodes.size());
+            node n = nodes_[i];
+            if(n.level == leaf_level)
+            {
+                n.child[0] = static_cast<node_id>(leaves.size());
+                leaves.push_back(leaves_[nodes_[i].child[0]]);
+            }
+            else
+            {
+                for(auto& c : n.child) {c = new_id[c];}
+            }
+            nodes.push_back(n);
+        }
+        for(auto& n : nodes)
+        {
+            if(n.result != npos) {n.result = new_id[n.result];}
+        }
+
+        std::unordered_map<std::uint64_t, node_id> memo;
+        for(const auto& [key, value] : memo_)
+        {
+            const auto k = new_id[key >> 8];
+            const auto v = new_id[value];
+            if(k != npos && v != npos)
+            {
+                memo.emplace((std::uint64_t(k) << 8) | (key & 0xFF), v);
+            }
+        }
+
+        nodes_  = std::move(nodes);
+        leaves_ = std::move(leaves);
+        memo_   = std::move(memo);
+        root_   = new_id[root_];
+        for(auto& e : empty_)
+        {
+            if(e != npos) {e = new_id[e];}
+        }
+        table_.clear();
+        leaf_table_.clear();
+        for(std::size_t i=0; i<nodes_.size(); ++i)
+        {
+            const auto& n = nodes_[i];
+            if(n.level == leaf_level)
+            {
+                leaf_table_.emplace(leaves_[n.child[0]], static_cast<node_id>(i));
+            }
+            else
+            {
+                table_.emplace(children_type{{n.child[0], n.child[1],
+                               n.child[2], n.child[3]}}, static_cast<node_id>(i));
+            }
+        }
+        return;
+    }
+
+  private:
+
+    std::size_t   width_, height_;
+    std::uint64_t generation_;
+    std::int64_t  origin_x_, origin_y_; // position of the root in the world
+    std::uint64_t clock_;
+    std::size_t   cache_limit_;
+    node_id       root_;
+
+    std::vector<node>    nodes_;
+    std::vector<chunk>   leaves_;
+    std::vector<node_id> empty_; // empty node of each level
+    std::unordered_map<children_type, node_id, children_hasher> table_;
+    std::unordered_map<chunk, node_id, leaf_hasher, leaf_equal> leaf_table_;
+    std::unordered_map<std::uint64_t, node_id> memo_; // results of j < level-2
+};
+
+} // haywire
+#endif// HAYWIRE_HASHLIFE_HPP
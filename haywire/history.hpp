@@ -0,0 +1,292 @@
+#ifndef HAYWIRE_HISTORY_HPP
+#define HAYWIRE_HISTORY_HPP
+#include "world.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace haywire
+{
+
+// A bounded history of a world for rewinding.
+//
+// Each generation is recorded as a frame. A delta frame has only the chunks
+// changed by the update(), and a keyframe has all the non-empty chunks. Chunks
+// are encoded in the same way as the snapshot (.hwb). A keyframe is recorded
+// every `keyframe_interval` generations and whenever the world is resized, so
+// a generation is restored from a keyframe and the deltas after it. Edits are
+// appended to the frame of the generation as another delta. When the frames
+// exceed the memory limit, the oldest keyframe and its deltas are discarded
+// together. The last keyframe and its deltas are always kept, so the history
+// can exceed the limit if they alone do.
+struct history
+{
+    history(const std::size_t memory_limit, const std::size_t keyframe_interval = 64)
+        : memory_limit_(memory_limit), keyframe_interval_(keyframe_interval)
+    {}
+
+    // records a world after update(). If the world has been modified in
+    // another way since the last record, `is_edited` must be true, and the
+    // modified chunks should be the ones found by world::for_each_edited_chunk.
+    // If the generation is already recorded and the world is not edited, the
+    // frame is kept as is. Otherwise, frames after it are discarded. The
+    // overview of the world should be up to date (see world::update_overview()).
+    void record(const world& w, const std::uint64_t generation, const bool is_edited)
+    {
+        if(memory_limit_ == 0)
+        {
+            return;
+        }
+        if(not frames_.empty() && generation <= frames_.back().generation)
+        {
+            if(not is_edited && this->contains(generation))
+            {
+                return;
+            }
+            this->truncate(generation + 1);
+        }
+
+        // the edited chunks are added to the frame of the same world
+        if(is_edited && not frames_.empty() && frames_.back().generation == generation &&
+           this->has_same_geometry(frames_.back(), w))
+        {
+            auto& f = frames_.back();
+            this->memory_usage_ -= memory_of(f);
+            w.for_each_edited_chunk([&](const std::size_t x, const std::size_t y) {
+                append(f, x, y, w.chunk_at(x, y, std::nothrow), false);
+            });
+            f.data.shrink_to_fit();
+            this->memory_usage_ += memory_of(f);
+            this->evict();
+            return;
+        }
+        this->truncate(generation);
+
+        const bool is_keyframe = frames_.empty() ||
+            frames_.back().generation + 1 != generation ||
+            keyframe_interval_ <= generation - last_keyframe_ ||
+            not this->has_same_geometry(frames_.back(), w);
+
+        frame f;
+        f.generation  = generation;
+        f.is_keyframe = is_keyframe;
+        f.width       = w.width();
+        f.height      = w.height();
+        f.origin_x    = w.origin_x();
+        f.origin_y    = w.origin_y();
+        if(is_keyframe)
+        {
+            w.for_each_nonempty_chunk([&](const std::size_t x, const std::size_t y) {
+                append(f, x, y, w.chunk_at(x, y, std::nothrow), true);
+            });
+            this->last_keyframe_ = generation;
+        }
+        else
+        {
+            w.for_each_changed_chunk([&](const std::size_t x, const std::size_t y) {
+                append(f, x, y, w.chunk_at(x, y, std::nothrow), false);
+            });
+        }
+        f.data.shrink_to_fit();
+        this->memory_usage_ += memory_of(f);
+        frames_.push_back(std::move(f));
+        this->evict();
+        return;
+    }
+
+    // re-constructs the world at the generation.
+    world restore(const std::uint64_t generation) const
+    {
+        const auto target = this->find(generation);
+        if(target == frames_.end())
+        {
+            throw std::out_of_range("haywire::history::restore: generation " +
+                    std::to_string(generation) + " is not recorded");
+        }
+        auto key = target;
+        while(not key->is_keyframe)
+        {
+            --key;
+        }
+
+        // a world of the same size and origin
+        world w(key->width - key->origin_x, key->height - key->origin_y);
+        w.expand(key->origin_x / chunk::width, 0, key->origin_y / chunk::height, 0);
+
+        for(auto iter = key; iter != target + 1; ++iter)
+        {
+            const char* ptr  = iter->data.data();
+            const char* last = ptr + iter->data.size();
+            while(ptr != last)
+            {
+                const auto x    = snapshot_format::get<std::uint32_t>(ptr);
+                const auto y    = snapshot_format::get<std::uint32_t>(ptr + 4);
+                const auto size = static_cast<unsigned char>(ptr[8]);
+                snapshot_format::decode(ptr + 9, size, w.chunk_at(x, y, std::nothrow));
+                ptr += 9 + size;
+            }
+        }
+        w.recount();
+        w.mark_all_dirty();
+        return w;
+    }
+
+    bool contains(const std::uint64_t generation) const noexcept
+    {
+        return this->find(generation) != frames_.end();
+    }
+
+    // the newest recorded generation not after the given one.
+    std::optional<std::uint64_t> at_or_before(const std::uint64_t generation) const noexcept
+    {
+        const auto iter = std::upper_bound(frames_.begin(), frames_.end(), generation,
+                [](const std::uint64_t g, const frame& f) noexcept {return g < f.generation;});
+        if(iter == frames_.begin())
+        {
+            return std::nullopt;
+        }
+        return std::prev(iter)->generation;
+    }
+
+    bool          empty()  const noexcept {return frames_.empty();}
+    std::size_t   size()   const noexcept {return frames_.size();}
+    std::uint64_t oldest() const noexcept {return frames_.empty() ? 0 : frames_.front().generation;}
+    std::uint64_t latest() const noexcept {return frames_.empty() ? 0 : frames_.back().generation;}
+
+    // bytes held by the frames
+    std::size_t memory_usage() const noexcept {return memory_usage_;}
+
+    // discards frames of the generation and later.
+    void truncate(const std::uint64_t generation)
+    {
+        while(not frames_.empty() && generation <= frames_.back().generation)
+        {
+            this->memory_usage_ -= memory_of(frames_.back());
+            frames_.pop_back();
+        }
+        if(not frames_.empty())
+        {
+            const auto key = std::find_if(frames_.rbegin(), frames_.rend(),
+                    [](const frame& fr) noexcept {return fr.is_keyframe;});
+            this->last_keyframe_ = key->generation;
+        }
+        return;
+    }
+
+    void clear()
+    {
+        frames_.clear();
+        this->memory_usage_ = 0;
+        return;
+    }
+
+  private:
+
+    // each chunk is x, y (u32 x2), size (u8) and the encoded cells.
+    struct frame
+    {
+        std::uint64_t     generation;
+        bool              is_keyframe;
+        std::size_t       width, height;
+        std::int64_t      origin_x, origin_y;
+        std::vector<char> data;
+    };
+
+    static std::size_t memory_of(const frame& f) noexcept
+    {
+        return sizeof(frame) + f.data.capacity();
+    }
+
+    static bool has_same_geometry(const frame& f, const world& w) noexcept
+    {
+        return f.width    == w.width()    && f.height   == w.height() &&
+               f.origin_x == w.origin_x() && f.origin_y == w.origin_y();
+    }
+
+    // discards the oldest keyframe and its deltas while the frames exceed the
+    // limit. The last keyframe and its deltas are always kept.
+    void evict()
+    {
+        while(memory_limit_ < memory_usage_)
+        {
+            const auto next = std::find_if(frames_.begin() + 1, frames_.end(),
+                    [](const frame& fr) noexcept {return fr.is_keyframe;});
+            if(next == frames_.end())
+            {
+                break;
+            }
+            for(auto iter = frames_.begin(); iter != next; ++iter)
+            {
+                this->memory_usage_ -= memory_of(*iter);
+            }
+            frames_.erase(frames_.begin(), next);
+        }
+        return;
+    }
+
+    // Deltas are recorded in every generation, so their chunks are always
+    // packed for speed. Chunks in keyframes are run-length encoded if it is
+    // smaller, as snapshot_format::encode does.
+    static void append(frame& f, const std::uint32_t x, const std::uint32_t y,
+                       const chunk& ch, const bool try_runs)
+    {
+        namespace fmt = snapshot_format;
+        const std::size_t pos = f.data.size();
+        f.data.resize(pos + 9 + fmt::packed_size);
+        fmt::put(f.data, pos,     x);
+        fmt::put(f.data, pos + 4, y);
+        char* out = f.data.data() + pos + 9;
+
+        std::size_t size = try_runs ? 0 : fmt::packed_size;
+        for(std::size_t i=0; i<ch.cells.size() && size < fmt::packed_size; )
+        {
+            const state s = ch.cells[i];
+            std::size_t len = 1;
+            while(i + len < ch.cells.size() && ch.cells[i + len] == s)
+            {
+                ++len;
+            }
+            out[size++] = static_cast<char>(((len - 1) << 2) | s);
+            i += len;
+        }
+        if(size == fmt::packed_size)
+        {
+            std::fill_n(out, fmt::packed_size, 0);
+            for(std::size_t i=0; i<ch.cells.size(); ++i)
+            {
+                out[i / 4] = static_cast<char>(out[i / 4] | (ch.cells[i] << (2 * (i % 4))));
+            }
+        }
+        f.data[pos + 8] = static_cast<char>(size);
+        f.data.resize(pos + 9 + size);
+        return;
+    }
+
+    // frames are sorted by generation, but not always consecutive.
+    std::deque<frame>::const_iterator find(const std::uint64_t generation) const noexcept
+    {
+        const auto iter = std::lower_bound(frames_.begin(), frames_.end(), generation,
+                [](const frame& f, const std::uint64_t g) noexcept {return f.generation < g;});
+        if(iter == frames_.end() || iter->generation != generation)
+        {
+            return frames_.end();
+        }
+        return iter;
+    }
+
+  private:
+    std::size_t       memory_limit_;
+    std::size_t       keyframe_interval_;
+    std::size_t       memory_usage_  = 0;
+    std::uint64_t     last_keyframe_ = 0;
+    std::deque<frame> frames_;
+};
+
+} // haywire
+#endif// HAYWIRE_HISTORY_HPP
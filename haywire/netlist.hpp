@@ -0,0 +1,198 @@
+#ifndef HAYWIRE_NETLIST_HPP
+#define HAYWIRE_NETLIST_HPP
+#include "world.hpp"
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+namespace haywire
+{
+
+// Adjacency graph of conductor cells in compressed sparse row format.
+// Nodes are numbered in row-major order of the cells.
+struct conductor_graph
+{
+    static constexpr inline std::uint32_t npos = 0xFFFFFFFFu;
+
+    explicit conductor_graph(const world& w)
+        : width_(w.width()), height_(w.height()), row_offsets_(w.height() + 1, 0)
+    {
+        for(std::size_t y=0; y<height_; ++y)
+        {
+            row_offsets_[y] = xs_.size();
+            for(std::size_t x=0; x<width_; ++x)
+            {
+                if(w(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y))
+                        != state::vacuum)
+                {
+                    xs_.push_back(x);
+                    ys_.push_back(y);
+                }
+            }
+        }
+        row_offsets_[height_] = xs_.size();
+
+        offsets_.reserve(xs_.size() + 1);
+        offsets_.push_back(0);
+        for(std::uint32_t i=0; i<xs_.size(); ++i)
+        {
+            const std::int64_t x = xs_[i];
+            const std::int64_t y = ys_[i];
+            for(std::int64_t dy=-1; dy<=1; ++dy)
+            {
+                for(std::int64_t dx=-1; dx<=1; ++dx)
+                {
+                    if(dx == 0 && dy == 0) {continue;}
+                    const auto n = this->find(x + dx, y + dy);
+                    if(n != npos)
+                    {
+                        neighbors_.push_back(n);
+                    }
+                }
+            }
+            offsets_.push_back(neighbors_.size());
+        }
+    }
+
+    std::size_t size() const noexcept {return xs_.size();}
+
+    std::uint32_t x(const std::uint32_t i) const noexcept {return xs_[i];}
+    std::uint32_t y(const std::uint32_t i) const noexcept {return ys_[i];}
+
+    std::uint32_t const* neighbors_begin(const std::uint32_t i) const noexcept
+    {
+        return neighbors_.data() + offsets_[i];
+    }
+    std::uint32_t const* neighbors_end(const std::uint32_t i) const noexcept
+    {
+        return neighbors_.data() + offsets_[i+1];
+    }
+
+    // returns npos if (x, y) is not a conductor.
+    std::uint32_t find(const std::int64_t x, const std::int64_t y) const noexcept
+    {
+        if(x < 0 || static_cast<std::int64_t>(width_)  <= x ||
+           y < 0 || static_cast<std::int64_t>(height_) <= y)
+        {
+            return npos;
+        }
+        const auto first = xs_.begin() + row_offsets_[y];
+        const auto last  = xs_.begin() + row_offsets_[y+1];
+        const auto found = std::lower_bound(first, last, static_cast<std::uint32_t>(x));
+        if(found == last || *found != x)
+        {
+            return npos;
+        }
+        return static_cast<std::uint32_t>(std::distance(xs_.begin(), found));
+    }
+
+    std::size_t width()  const noexcept {return width_ ;}
+    std::size_t height() const noexcept {return height_;}
+
+  private:
+    std::size_t width_, height_;
+    std::vector<std::uint32_t> xs_, ys_;
+    std::vector<std::uint32_t> row_offsets_; // first node in each row
+    std::vector<std::uint32_t> offsets_;     // first neighbor of each node
+    std::vector<std::uint32_t> neighbors_;
+};
+
+// Event-driven engine on a conductor graph. Only the heads and the wires next
+// to them are visited, so the cost of a step is proportional to the number of
+// electrons, not to the area. The result is the same as world::update().
+struct netlist_engine
+{
+    explicit netlist_engine(const world& w)
+        : graph_(w), states_(graph_.size()), counts_(graph_.size(), 0),
+          is_changed_(graph_.size(), 0)
+    {
+        for(std::uint32_t i=0; i<graph_.size(); ++i)
+        {
+            states_[i] = w(graph_.x(i), graph_.y(i));
+            if(states_[i] == state::head) {heads_.push_back(i);}
+            if(states_[i] == state::tail) {tails_.push_back(i);}
+        }
+    }
+
+    void update()
+    {
+        // count heads around wires next to heads
+        candidates_.clear();
+        for(const auto h : heads_)
+        {
+            for(auto n = graph_.neighbors_begin(h); n != graph_.neighbors_end(h); ++n)
+            {
+                if(states_[*n] == state::wire && counts_[*n]++ == 0)
+                {
+                    candidates_.push_back(*n);
+                }
+            }
+        }
+        next_heads_.clear();
+        for(const auto c : candidates_)
+        {
+            if(counts_[c] == 1 || counts_[c] == 2)
+            {
+                next_heads_.push_back(c);
+            }
+            counts_[c] = 0;
+        }
+
+        for(const auto t : tails_)      {this->set(t, state::wire);}
+        for(const auto h : heads_)      {this->set(h, state::tail);}
+        for(const auto n : next_heads_) {this->set(n, state::head);}
+
+        std::swap(tails_, heads_);
+        std::swap(heads_, next_heads_);
+        return;
+    }
+
+    // writes cells that have been changed since the last call.
+    void store(world& w)
+    {
+        assert(w.width() == graph_.width() && w.height() == graph_.height());
+        for(const auto i : changed_)
+        {
+            w(graph_.x(i), graph_.y(i)) = states_[i];
+            is_changed_[i] = 0;
+        }
+        changed_.clear();
+        return;
+    }
+
+    state operator()(const std::int64_t x, const std::int64_t y) const noexcept
+    {
+        const auto i = graph_.find(x, y);
+        return (i == conductor_graph::npos) ? state::vacuum : states_[i];
+    }
+
+    std::size_t num_heads() const noexcept {return heads_.size();}
+
+    std::size_t width()  const noexcept {return graph_.width() ;}
+    std::size_t height() const noexcept {return graph_.height();}
+
+  private:
+
+    void set(const std::uint32_t i, const state s)
+    {
+        states_[i] = s;
+        if(is_changed_[i] == 0)
+        {
+            is_changed_[i] = 1;
+            changed_.push_back(i);
+        }
+        return;
+    }
+
+  private:
+    conductor_graph            graph_;
+    std::vector<state>         states_;
+    std::vector<std::uint8_t>  counts_;     // number of heads around
+    std::vector<std::uint8_t>  is_changed_; // not written back yet
+    std::vector<std::uint32_t> heads_, tails_, candidates_, next_heads_;
+    std::vector<std::uint32_t> changed_;
+};
+
+} // haywire
+#endif// HAYWIRE_NETLIST_HPP
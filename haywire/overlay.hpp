@@ -0,0 +1,102 @@
+#ifndef HAYWIRE_OVERLAY_HPP
+#define HAYWIRE_OVERLAY_HPP
+#include <SDL.h>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdint>
+
+namespace haywire
+{
+
+// A tiny 3x5 bitmap font to draw text without any font library. A glyph is
+// 15 bits, 3 bits per row from the top, and the MSB of a row is the left.
+struct bitmap_font
+{
+    static constexpr inline int glyph_width  = 3;
+    static constexpr inline int glyph_height = 5;
+    static constexpr inline int advance      = glyph_width  + 1;
+    static constexpr inline int line_height  = glyph_height + 2;
+
+    // from ' ' to 'Z'. Lowercase letters are drawn as uppercase and unknown
+    // characters are drawn as space.
+    static std::uint16_t glyph_of(const char c) noexcept
+    {
+        constexpr std::array<std::uint16_t, 59> glyphs = {{
+            0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x52A5, 0x0000, 0x0000,
+            0x1491, 0x4494, 0x0000, 0x0000, 0x0014, 0x01C0, 0x0002, 0x12A4,
+            0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF, 0x79EF, 0x7249,
+            0x7BEF, 0x7BCF, 0x0410, 0x0000, 0x0000, 0x0E38, 0x0000, 0x0000,
+            0x0000, 0x2BED, 0x6BAE, 0x3923, 0x6B6E, 0x79A7, 0x79A4, 0x396B,
+            0x5BED, 0x7497, 0x126A, 0x5BAD, 0x4927, 0x5FED, 0x6B6D, 0x2B6A,
+            0x6BA4, 0x2B73, 0x6BAD, 0x388E, 0x7492, 0x5B6F, 0x5B6A, 0x5BFD,
+            0x5AAD, 0x5A92, 0x72A7,
+        }};
+        const int code = std::toupper(static_cast<unsigned char>(c)) - ' ';
+        if(code < 0 || static_cast<int>(glyphs.size()) <= code)
+        {
+            return 0;
+        }
+        return glyphs[code];
+    }
+
+    // in pixels, without scaling
+    static int width_of(const std::string& line) noexcept
+    {
+        return line.empty() ? 0 : static_cast<int>(line.size()) * advance - 1;
+    }
+};
+
+// draws lines of text on a translucent box at (x, y). A pixel of the font is
+// drawn as a `scale` x `scale` square.
+inline void draw_text_box(SDL_Renderer* renderer, const int x, const int y,
+                          const int scale, const std::vector<std::string>& lines)
+{
+    constexpr int padding = 2;
+
+    int width = 0;
+    for(const auto& line : lines)
+    {
+        width = std::max(width, bitmap_font::width_of(line));
+    }
+    const int height = static_cast<int>(lines.size()) * bitmap_font::line_height - 2;
+
+    const SDL_Rect box{x, y, (width + 2 * padding) * scale, (height + 2 * padding) * scale};
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xC0);
+    SDL_RenderFillRect(renderer, &box);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    std::vector<SDL_Rect> pixels;
+    for(std::size_t i=0; i<lines.size(); ++i)
+    {
+        const int top = y + (padding + static_cast<int>(i) * bitmap_font::line_height) * scale;
+        int left = x + padding * scale;
+        for(const char c : lines[i])
+        {
+            const auto glyph = bitmap_font::glyph_of(c);
+            for(int row=0; row<bitmap_font::glyph_height; ++row)
+            {
+                for(int col=0; col<bitmap_font::glyph_width; ++col)
+                {
+                    const int bit = (bitmap_font::glyph_height - 1 - row) *
+                                    bitmap_font::glyph_width + (bitmap_font::glyph_width - 1 - col);
+                    if((glyph >> bit) & 1u)
+                    {
+                        pixels.push_back(SDL_Rect{left + col * scale, top + row * scale,
+                                                  scale, scale});
+                    }
+                }
+            }
+            left += bitmap_font::advance * scale;
+        }
+    }
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderFillRects(renderer, pixels.data(), static_cast<int>(pixels.size()));
+    return;
+}
+
+} // haywire
+#endif// HAYWIRE_OVERLAY_HPP
@@ -0,0 +1,604 @@
+#ifndef HAYWIRE_RLE_HPP
+#define HAYWIRE_RLE_HPP
+#include "world.hpp"
+#include "sparse_world.hpp"
+#include <algorithm>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cctype>
+#include <cstdint>
+
+// Streaming reader and writer of Golly RLE and MCell MCL patterns.
+//
+// In both formats, WireWorld states are `.` (vacuum), `A` (head), `B` (tail)
+// and `C` (wire). A token may be preceded by a run count, and `$` ends a row.
+// Lines are read one by one and cells are written into chunks directly, of
+// a world or of a sparse_world.
+
+namespace haywire
+{
+
+namespace pattern_format
+{
+
+// writes runs of cells into a world. The world is expanded if the pattern
+// does not fit in it. Cells are placed relative to (x0, y0) of the world at
+// the time the sink is constructed, even after the world expands to the minus
+// direction. Vacuum in the pattern does not clear cells.
+struct sink
+{
+    // cells of a world are addressed by int32
+    static constexpr inline std::int64_t max_extent = std::numeric_limits<std::int32_t>::max();
+
+    sink(world& w, const std::int64_t x0, const std::int64_t y0)
+        : world_(w), x0_(x0), y0_(y0), origin_x_(w.origin_x()), origin_y_(w.origin_y())
+    {}
+
+    void put(const std::int64_t x, const std::int64_t y, const std::int64_t n, const state s)
+    {
+        if(s == state::vacuum || n <= 0)
+        {
+            return;
+        }
+        const auto [x_w, y_w] = this->cover(x, y, x + n, y + 1);
+        const std::size_t y_chk = y_w / chunk::height;
+        const std::size_t y_in  = y_w % chunk::height;
+        for(std::int64_t i = x_w; i < x_w + n; )
+        {
+            const std::size_t x_chk = i / chunk::width;
+            const std::int64_t last = std::min<std::int64_t>(
+                    x_w + n, (x_chk + 1) * chunk::width);
+            auto& ch = world_.chunk_at(x_chk, y_chk, std::nothrow);
+            for(; i < last; ++i)
+            {
+                ch(i % chunk::width, y_in) = s;
+            }
+        }
+        return;
+    }
+
+  private:
+
+    // returns the position of (x0, y0) in the current world
+    std::pair<std::int64_t, std::int64_t> cover(
+        const std::int64_t x0, const std::int64_t y0,
+        const std::int64_t x1, const std::int64_t y1)
+    {
+        const auto shift_x = x0_ + world_.origin_x() - origin_x_;
+        const auto shift_y = y0_ + world_.origin_y() - origin_y_;
+        const auto width   = static_cast<std::int64_t>(world_.width());
+        const auto height  = static_cast<std::int64_t>(world_.height());
+        if(std::max(x1 + shift_x, width)  - std::min<std::int64_t>(x0 + shift_x, 0) > max_extent ||
+           std::max(y1 + shift_y, height) - std::min<std::int64_t>(y0 + shift_y, 0) > max_extent)
+        {
+            throw std::runtime_error("haywire::pattern: out of the range of the world");
+        }
+        world_.expand_to_cover(x0 + shift_x, y0 + shift_y, x1 + shift_x, y1 + shift_y);
+        return std::make_pair(x0 + x0_ + world_.origin_x() - origin_x_,
+                              y0 + y0_ + world_.origin_y() - origin_y_);
+    }
+
+  private:
+    world&       world_;
+    std::int64_t x0_, y0_;
+    std::int64_t origin_x_, origin_y_;
+};
+
+// writes runs of cells into a sparse_world. It covers any position within
+// max_extent of (x0, y0).
+struct sparse_sink
+{
+    // keeps the chunk coordinates and their neighbors in int64
+    static constexpr inline std::int64_t max_extent = std::int64_t(1) << 62;
+
+    sparse_sink(sparse_world& w, const std::int64_t x0, const std::int64_t y0)
+        : world_(w), x0_(x0), y0_(y0)
+    {
+        if(x0 < -max_extent || max_extent < x0 || y0 < -max_extent || max_extent < y0)
+        {
+            throw std::runtime_error("haywire::pattern: out of the range of the world");
+        }
+    }
+
+    void put(const std::int64_t x, const std::int64_t y, const std::int64_t n, const state s)
+    {
+        if(s == state::vacuum)
+        {
+            return;
+        }
+        for(std::int64_t i=0; i<n; ++i)
+        {
+            world_.set(x0_ + x + i, y0_ + y, s);
+        }
+        return;
+    }
+
+  private:
+    sparse_world& world_;
+    std::int64_t  x0_, y0_;
+};
+
+// parses tokens of the cells. It keeps the position and the run count, so
+// the data can be fed line by line. Run counts and positions beyond
+// Sink::max_extent are rejected.
+template<typename Sink>
+struct parser
+{
+    explicit parser(Sink& s): sink_(s) {}
+
+    // returns false if the end of the pattern (`!`) is found.
+    bool feed(const std::string& line)
+    {
+        for(const char c : line)
+        {
+            if(std::isdigit(static_cast<unsigned char>(c)))
+            {
+                const std::int64_t digit = c - '0';
+                if((Sink::max_extent - digit) / 10 < count_)
+                {
+                    throw std::runtime_error("haywire::pattern: too long run");
+                }
+                this->count_ = count_ * 10 + digit;
+                continue;
+            }
+            const std::int64_t n = (count_ == 0) ? 1 : count_;
+            this->count_ = 0;
+            switch(c)
+            {
+                case '!': {return false;}
+                case '$': {this->advance(y_, n); this->x_ = 0; break;}
+                case '.':
+                case 'b': {this->advance(x_, n); break;}
+                case 'o':
+                case 'A': {this->put(n, state::head); break;}
+                case 'B': {this->put(n, state::tail); break;}
+                case 'C': {this->put(n, state::wire); break;}
+                default:
+                {
+                    if(std::isspace(static_cast<unsigned char>(c)))
+                    {
+                        break;
+                    }
+                    throw std::runtime_error(std::string("haywire::pattern: "
+                        "unsupported cell state `") + c + "` for WireWorld");
+                }
+            }
+        }
+        return true;
+    }
+
+  private:
+
+    void advance(std::int64_t& pos, const std::int64_t n)
+    {
+        if(Sink::max_extent - n < pos)
+        {
+            throw std::runtime_error("haywire::pattern: out of the range of the world");
+        }
+        pos += n;
+        return;
+    }
+    void put(const std::int64_t n, const state s)
+    {
+        const std::int64_t x = x_;
+        this->advance(x_, n);
+        sink_.put(x, y_, n, s);
+        return;
+    }
+
+  private:
+    Sink&        sink_;
+    std::int64_t x_     = 0;
+    std::int64_t y_     = 0;
+    std::int64_t count_ = 0;
+};
+
+// writes runs of cells row by row, wrapping lines.
+struct emitter
+{
+    emitter(std::ostream& os, std::string prefix, const std::size_t width)
+        : os_(os), prefix_(std::move(prefix)), width_(width)
+    {}
+
+    void put(const std::size_t n, const char c)
+    {
+        if(n == 0) {return;}
+        this->token_.clear();
+        if(n != 1)
+        {
+            this->token_ = std::to_string(n);
+        }
+        this->token_ += c;
+
+        if(line_.size() + token_.size() > width_)
+        {
+            this->flush();
+        }
+        this->line_ += token_;
+        return;
+    }
+    void flush()
+    {
+        if(not line_.empty())
+        {
+            os_ << prefix_ << line_ << '\n';
+            this->line_.clear();
+        }
+        return;
+    }
+
+  private:
+    std::ostream& os_;
+    std::string   prefix_;
+    std::size_t   width_;
+    std::string   line_, token_;
+};
+
+inline char token_of(const state s) noexcept
+{
+    switch(s)
+    {
+        case state::vacuum: {return '.';}
+        case state::head:   {return 'A';}
+        case state::tail:   {return 'B';}
+        case state::wire:   {return 'C';}
+    }
+    return '.';
+}
+
+// writes runs of cells row by row. Vacuum at the end of rows and empty rows
+// at the end are omitted, and adjacent runs of the same state are merged.
+struct row_writer
+{
+    explicit row_writer(emitter& out): out_(out) {}
+
+    void put(const std::size_t n, const state s)
+    {
+        if(n == 0)
+        {
+            return;
+        }
+        if(len_ != 0 && s != state_)
+        {
+            this->flush();
+        }
+        this->state_ = s;
+        this->len_  += n;
+        return;
+    }
+    // ends the current row and skips n-1 empty rows
+    void end_rows(const std::size_t n = 1)
+    {
+        if(len_ != 0 && state_ != state::vacuum)
+        {
+            this->flush();
+        }
+        this->len_        = 0;
+        this->vacuum_     = 0;
+        this->is_empty_   = true;
+        this->empty_rows_ += n;
+        return;
+    }
+
+  private:
+
+    void flush()
+    {
+        if(state_ == state::vacuum)
+        {
+            this->vacuum_ = len_; // written only if a cell follows
+        }
+        else
+        {
+            if(is_empty_)
+            {
+                out_.put(empty_rows_, '$');
+                this->empty_rows_ = 0;
+                this->is_empty_   = false;
+            }
+            out_.put(vacuum_, '.');
+            out_.put(len_, token_of(state_));
+            this->vacuum_ = 0;
+        }
+        this->len_ = 0;
+        return;
+    }
+
+  private:
+    emitter&    out_;
+    state       state_      = state::vacuum;
+    std::size_t len_        = 0;
+    std::size_t vacuum_     = 0;
+    std::size_t empty_rows_ = 0;
+    bool        is_empty_   = true;
+};
+
+inline void write_cells(emitter& out, const world& w)
+{
+    row_writer rows(out);
+    for(std::size_t y=0; y<w.height(); ++y)
+    {
+        std::size_t x = 0;
+        while(x < w.width())
+        {
+            const state s = w(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y));
+            std::size_t len = 1;
+            while(x + len < w.width() && w(static_cast<std::int32_t>(x + len),
+                                           static_cast<std::int32_t>(y)) == s)
+            {
+                ++len;
+            }
+            x += len;
+            rows.put(len, s);
+        }
+        rows.end_rows();
+    }
+    return;
+}
+
+// chunk (b.x0, b.y0) is written at (0, 0). Only the chunks are visited, so
+// the gaps between distant parts cost nothing.
+inline void write_cells(emitter& out, const sparse_world& w, const chunk_bounds& b)
+{
+    std::vector<std::pair<chunk_key, const chunk*>> chunks;
+    w.for_each_chunk([&chunks](const std::int64_t x, const std::int64_t y, const chunk& ch) {
+        chunks.emplace_back(chunk_key{x, y}, &ch);
+    });
+    std::sort(chunks.begin(), chunks.end(), [](const auto& lhs, const auto& rhs) noexcept {
+        return std::make_pair(lhs.first.y, lhs.first.x) < std::make_pair(rhs.first.y, rhs.first.x);
+    });
+
+    row_writer rows(out);
+    std::int64_t y_next = b.y0;
+    for(std::size_t first=0; first < chunks.size(); )
+    {
+        const std::int64_t y_chk = chunks[first].first.y;
+        std::size_t last = first;
+        while(last < chunks.size() && chunks[last].first.y == y_chk)
+        {
+            ++last;
+        }
+        if(y_next < y_chk)
+        {
+            rows.end_rows(static_cast<std::size_t>(y_chk - y_next) * chunk::height);
+        }
+        for(std::size_t y=0; y<chunk::height; ++y)
+        {
+            std::int64_t x_next = b.x0;
+            for(std::size_t i=first; i<last; ++i)
+            {
+                const auto& [key, ch] = chunks[i];
+                rows.put(static_cast<std::size_t>(key.x - x_next) * chunk::width, state::vacuum);
+                for(std::size_t x=0; x<chunk::width; ++x)
+                {
+                    rows.put(1, (*ch)(x, y));
+                }
+                x_next = key.x + 1;
+            }
+            rows.end_rows();
+        }
+        y_next = y_chk + 1;
+        first  = last;
+    }
+    return;
+}
+
+inline bool starts_with(const std::string& str, const std::string& prefix)
+{
+    return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
+}
+
+// returns the value of `key = value` in the RLE header, or empty string.
+inline std::string header_value(const std::string& line, const std::string& key)
+{
+    std::size_t pos = 0;
+    while(pos < line.size())
+    {
+        const auto eq    = line.find('=', pos);
+        const auto comma = line.find(',', pos);
+        if(eq == std::string::npos) {break;}
+
+        std::string k = line.substr(pos, eq - pos);
+        k.erase(std::remove_if(k.begin(), k.end(),
+                [](const char c) {return std::isspace(static_cast<unsigned char>(c));}), k.end());
+
+        const auto end = (comma == std::string::npos) ? line.size() : comma;
+        if(k == key)
+        {
+            std::string v = line.substr(eq + 1, end - eq - 1);
+            v.erase(0, v.find_first_not_of(" \t\r"));
+            v.erase(v.find_last_not_of(" \t\r") + 1);
+            return v;
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+// empty rule is taken as WireWorld
+inline bool is_wireworld(const std::string& rule)
+{
+    std::string lower(rule);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+        [](const char c) {return std::tolower(static_cast<unsigned char>(c));});
+    return rule.empty() || starts_with(lower, "wireworld");
+}
+
+// returns the non-negative integer in `value`, or -1 if it is not one.
+inline std::int64_t parse_size(const std::string& value)
+{
+    if(value.empty() || not std::all_of(value.begin(), value.end(),
+            [](const char c) {return std::isdigit(static_cast<unsigned char>(c));}))
+    {
+        return -1;
+    }
+    try
+    {
+        return std::stoll(value);
+    }
+    catch(const std::out_of_range&)
+    {
+        return -1;
+    }
+}
+
+// reads a pattern into a sink, which is a world or a sparse_world.
+template<typename Sink>
+void read_rle(std::istream& is, Sink& sink)
+{
+    parser<Sink> parser(sink);
+
+    bool is_header = true;
+    std::string line;
+    while(std::getline(is, line))
+    {
+        if(line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+        if(is_header)
+        {
+            is_header = false;
+            if(starts_with(line, "x"))
+            {
+                const auto rule = header_value(line, "rule");
+                if(not is_wireworld(rule))
+                {
+                    throw std::runtime_error("haywire::read_rle: unsupported rule: " + rule);
+                }
+                const auto width  = parse_size(header_value(line, "x"));
+                const auto height = parse_size(header_value(line, "y"));
+                if(width < 0 || height < 0 ||
+                   Sink::max_extent < width || Sink::max_extent < height)
+                {
+                    throw std::runtime_error("haywire::read_rle: bad header: " + line);
+                }
+                // the world grows as runs arrive. The size in the header is
+                // not trusted, since it may be much larger than the cells.
+                continue;
+            }
+        }
+        if(not parser.feed(line))
+        {
+            break;
+        }
+    }
+    return;
+}
+
+template<typename Sink>
+void read_mcl(std::istream& is, Sink& sink)
+{
+    parser<Sink> parser(sink);
+
+    std::string line;
+    while(std::getline(is, line))
+    {
+        if(starts_with(line, "#RULE"))
+        {
+            std::string rule = line.substr(5);
+            rule.erase(0, rule.find_first_not_of(" \t\r"));
+            rule.erase(rule.find_last_not_of(" \t\r") + 1);
+            if(not is_wireworld(rule))
+            {
+                throw std::runtime_error("haywire::read_mcl: unsupported rule: " + rule);
+            }
+        }
+        else if(starts_with(line, "#L"))
+        {
+            parser.feed(line.substr(2));
+        }
+    }
+    return;
+}
+
+} // pattern_format
+
+// reads an RLE pattern and puts it at (x0, y0) of the world.
+inline void read_rle(std::istream& is, world& w,
+                     const std::int64_t x0 = 0, const std::int64_t y0 = 0)
+{
+    pattern_format::sink sink(w, x0, y0);
+    pattern_format::read_rle(is, sink);
+    return;
+}
+inline void read_rle(std::istream& is, sparse_world& w,
+                     const std::int64_t x0 = 0, const std::int64_t y0 = 0)
+{
+    pattern_format::sparse_sink sink(w, x0, y0);
+    pattern_format::read_rle(is, sink);
+    return;
+}
+
+inline void write_rle(std::ostream& os, const world& w)
+{
+    namespace fmt = pattern_format;
+    os << "x = " << w.width() << ", y = " << w.height() << ", rule = WireWorld\n";
+    fmt::emitter out(os, "", 70);
+    pattern_format::write_cells(out, w);
+    out.put(1, '!');
+    out.flush();
+    return;
+}
+// the pattern covers bounds() of the world.
+inline void write_rle(std::ostream& os, const sparse_world& w)
+{
+    namespace fmt = pattern_format;
+    const auto b = w.bounds();
+    os << "x = " << (b.x1 - b.x0) * chunk::width << ", y = "
+       << (b.y1 - b.y0) * chunk::height << ", rule = WireWorld\n";
+    fmt::emitter out(os, "", 70);
+    pattern_format::write_cells(out, w, b);
+    out.put(1, '!');
+    out.flush();
+    return;
+}
+
+// reads an MCL pattern and puts it at (x0, y0) of the world. Only `#RULE`
+// and `#L` lines are read. The pattern is not centered on the board.
+inline void read_mcl(std::istream& is, world& w,
+                     const std::int64_t x0 = 0, const std::int64_t y0 = 0)
+{
+    pattern_format::sink sink(w, x0, y0);
+    pattern_format::read_mcl(is, sink);
+    return;
+}
+inline void read_mcl(std::istream& is, sparse_world& w,
+                     const std::int64_t x0 = 0, const std::int64_t y0 = 0)
+{
+    pattern_format::sparse_sink sink(w, x0, y0);
+    pattern_format::read_mcl(is, sink);
+    return;
+}
+
+inline void write_mcl(std::ostream& os, const world& w)
+{
+    namespace fmt = pattern_format;
+    os << "#MCell 4.20\n#GAME User DLL\n#RULE WireWorld\n";
+    os << "#BOARD " << w.width() << 'x' << w.height() << '\n';
+    fmt::emitter out(os, "#L ", 70);
+    pattern_format::write_cells(out, w);
+    out.flush();
+    return;
+}
+// the pattern covers bounds() of the world.
+inline void write_mcl(std::ostream& os, const sparse_world& w)
+{
+    namespace fmt = pattern_format;
+    const auto b = w.bounds();
+    os << "#MCell 4.20\n#GAME User DLL\n#RULE WireWorld\n";
+    os << "#BOARD " << (b.x1 - b.x0) * chunk::width << 'x'
+                    << (b.y1 - b.y0) * chunk::height << '\n';
+    fmt::emitter out(os, "#L ", 70);
+    pattern_format::write_cells(out, w, b);
+    out.flush();
+    return;
+}
+
+} // haywire
+#endif// HAYWIRE_RLE_HPP
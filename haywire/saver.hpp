@@ -0,0 +1,278 @@
+#ifndef HAYWIRE_SAVER_HPP
+#define HAYWIRE_SAVER_HPP
+#include "world.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace haywire
+{
+
+// writes a snapshot of a world or a packed_world into `fname` so that the
+// file is either the old one or the complete new one, even if the process or
+// the machine stops in the middle. The data is written into a temporary file,
+// flushed to the disk, and renamed.
+template<typename World>
+void save_atomically(const std::string& fname, const World& w)
+{
+    const std::string tmp = fname + ".tmp";
+    try
+    {
+        write_snapshot(tmp, w);
+    }
+    catch(...)
+    {
+        std::remove(tmp.c_str());
+        throw;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    const auto sync = [](const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd == -1)
+        {
+            return false;
+        }
+        const bool ok = (::fsync(fd) == 0);
+        ::close(fd);
+        return ok;
+    };
+    if(not sync(tmp))
+    {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("haywire::save_atomically: fsync failed: " + tmp);
+    }
+#endif
+    if(std::rename(tmp.c_str(), fname.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("haywire::save_atomically: rename failed: " + fname);
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    // the rename itself is recorded in the directory
+    const auto slash = fname.find_last_of('/');
+    sync(slash == std::string::npos ? std::string(".") : fname.substr(0, slash + 1));
+#endif
+    return;
+}
+
+// "<prefix>-YYYYmmdd-HHMMSS-mmm.hwb" in the local time. Names sort in the
+// order of time.
+inline std::string timestamped_name(const std::string& prefix)
+{
+    const auto now = std::chrono::system_clock::now();
+    const auto ms  = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now.time_since_epoch()).count() % 1000;
+    const std::time_t t = std::chrono::system_clock::to_time_t(now);
+    std::tm tm{};
+#if defined(_WIN32)
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    std::ostringstream oss;
+    oss << prefix << std::put_time(&tm, "-%Y%m%d-%H%M%S-")
+        << std::setw(3) << std::setfill('0') << ms << ".hwb";
+    return oss.str();
+}
+
+// Saves worlds on its own thread. A world to save is passed as a shared
+// packed_world, so the caller only queues it and never waits for the disk.
+//
+// Files are written by save_atomically(). Autosaves are rotated: only the
+// latest `num_autosaves` files written as autosaves are kept, and the older
+// ones are removed. Autosaves are expected to be named by
+// timestamped_name(autosave_prefix); the ones left by earlier runs are found
+// on construction and rotated out as well. A pending autosave is replaced by
+// a newer one, so a slow disk does not pile up copies of the world.
+struct background_saver
+{
+    // called on the saver thread with the file name and an error message,
+    // which is empty on success.
+    using callback_type = std::function<void(const std::string&, const std::string&)>;
+
+    explicit background_saver(const std::size_t num_autosaves = 5,
+                              callback_type on_saved = nullptr,
+                              const std::string& autosave_prefix = "haywire-autosave")
+        : num_autosaves_(num_autosaves), on_saved_(std::move(on_saved))
+    {
+        this->find_autosaves(autosave_prefix);
+        this->thread_ = std::thread([this]{this->run();});
+    }
+    ~background_saver()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            this->is_stopped_ = true;
+        }
+        cv_.notify_one();
+        thread_.join(); // pending saves are finished
+    }
+
+    background_saver(const background_saver&) = delete;
+    background_saver(background_saver&&)      = delete;
+    background_saver& operator=(const background_saver&) = delete;
+    background_saver& operator=(background_saver&&)      = delete;
+
+    void save(std::shared_ptr<const packed_world> w, std::string fname)
+    {
+        this->push(job{std::move(w), std::move(fname), false});
+        return;
+    }
+    void autosave(std::shared_ptr<const packed_world> w, std::string fname)
+    {
+        this->push(job{std::move(w), std::move(fname), true});
+        return;
+    }
+
+    // number of saves queued or in progress
+    std::size_t num_pending() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return jobs_.size() + is_busy_;
+    }
+
+  private:
+
+    struct job
+    {
+        std::shared_ptr<const packed_world> snapshot;
+        std::string                         fname;
+        bool                                is_autosave;
+    };
+
+    // the timestamps in the names sort in the order of time, so the oldest
+    // file comes first. The files are not removed until the next autosave.
+    void find_autosaves(const std::string& prefix)
+    {
+        namespace fs = std::filesystem;
+        const fs::path   path(prefix);
+        const fs::path   dir  = path.has_parent_path() ? path.parent_path() : fs::path(".");
+        const std::string head = path.filename().string() + "-";
+        const std::string tail = ".hwb";
+
+        std::vector<std::string> found;
+        std::error_code ec;
+        for(fs::directory_iterator iter(dir, ec), last; not ec && iter != last;
+            iter.increment(ec))
+        {
+            const std::string name = iter->path().filename().string();
+            if(name.size() < head.size() + tail.size() ||
+               name.compare(0, head.size(), head) != 0 ||
+               name.compare(name.size() - tail.size(), tail.size(), tail) != 0)
+            {
+                continue;
+            }
+            std::error_code type_ec;
+            if(not iter->is_regular_file(type_ec))
+            {
+                continue;
+            }
+            found.push_back(path.has_parent_path() ? (dir / name).string() : name);
+        }
+        std::sort(found.begin(), found.end());
+        this->autosaves_.assign(found.begin(), found.end());
+        return;
+    }
+
+    void push(job j)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if(j.is_autosave)
+            {
+                for(auto iter = jobs_.begin(); iter != jobs_.end(); ++iter)
+                {
+                    if(iter->is_autosave)
+                    {
+                        jobs_.erase(iter);
+                        break;
+                    }
+                }
+            }
+            jobs_.push_back(std::move(j));
+        }
+        cv_.notify_one();
+        return;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while(true)
+        {
+            cv_.wait(lock, [this] {return is_stopped_ || not jobs_.empty();});
+            if(jobs_.empty())
+            {
+                return; // stopped
+            }
+            job j = std::move(jobs_.front());
+            jobs_.pop_front();
+            this->is_busy_ = true;
+            lock.unlock();
+
+            std::string error;
+            try
+            {
+                save_atomically(j.fname, *j.snapshot);
+            }
+            catch(const std::exception& e)
+            {
+                error = e.what();
+            }
+            j.snapshot.reset();
+
+            if(j.is_autosave && error.empty())
+            {
+                this->autosaves_.push_back(j.fname);
+                while(num_autosaves_ < autosaves_.size())
+                {
+                    std::remove(autosaves_.front().c_str());
+                    autosaves_.pop_front();
+                }
+            }
+            if(on_saved_)
+            {
+                on_saved_(j.fname, error);
+            }
+            lock.lock();
+            this->is_busy_ = false;
+        }
+    }
+
+  private:
+    std::size_t             num_autosaves_;
+    callback_type           on_saved_;
+    std::deque<std::string> autosaves_; // owned by the saver thread
+
+    mutable std::mutex      mtx_;
+    std::condition_variable cv_;
+    std::deque<job>         jobs_;
+    bool                    is_busy_    = false;
+    bool                    is_stopped_ = false;
+    std::thread             thread_;
+};
+
+} // haywire
+#endif// HAYWIRE_SAVER_HPP
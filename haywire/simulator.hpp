@@ -0,0 +1,587 @@
+#ifndef HAYWIRE_SIMULATOR_HPP
+#define HAYWIRE_SIMULATOR_HPP
+#include "world.hpp"
+#include "engine.hpp"
+#include "history.hpp"
+#include "cycle.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace haywire
+{
+
+// Runs the simulation on its own thread. The world is owned by the thread and
+// is modified only through commands queued by the other threads. The latest
+// state is published as a snapshot through a triple buffer, so neither side
+// waits for the other. A buffer is brought up to date by copying only the
+// chunks that have changed since it was written last.
+//
+// Cells in commands are specified in the initial coordinates, i.e. a cell at
+// (x, y) in the world is at (x - origin_x(), y - origin_y()). It does not
+// change when the world expands before the command is applied.
+//
+// Generations advanced by the chunk engine are recorded in a history, so the
+// world can be rewound to a recorded generation. The engine also looks for a
+// cycle of the world, and once it is found, the whole periods are skipped
+// when the world is advanced by more than a period at once.
+struct simulator
+{
+    using engine_kind = haywire::engine_kind;
+
+    using clock_type = std::chrono::steady_clock;
+    static constexpr inline std::chrono::microseconds frame{16667};
+
+    explicit simulator(world w)
+        : world_(std::move(w)), engine_(make_engine(engine_kind::chunk, world_)),
+          snapshots_{world(0, 0), world(0, 0), world(0, 0)}
+    {
+        this->world_.update_overview();
+        for(auto& snapshot : snapshots_)
+        {
+            this->world_.publish_to(snapshot);
+        }
+        this->thread_ = std::thread([this]{this->run();});
+    }
+    ~simulator()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            this->is_stopped_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    simulator(const simulator&) = delete;
+    simulator(simulator&&)      = delete;
+    simulator& operator=(const simulator&) = delete;
+    simulator& operator=(simulator&&)      = delete;
+
+    // takes the latest snapshot if a new one has been published. Returns true
+    // if the snapshot is changed. Called only from one thread.
+    bool acquire() noexcept
+    {
+        if((middle_.load(std::memory_order_acquire) & fresh) == 0)
+        {
+            return false;
+        }
+        this->front_ = middle_.exchange(front_, std::memory_order_acq_rel) & ~fresh;
+        return true;
+    }
+    // valid until the next call of acquire().
+    const world& snapshot() const noexcept {return snapshots_[front_];}
+
+    // number of commands applied to the current snapshot. Commands are
+    // numbered from 1 in the order of push.
+    std::uint64_t snapshot_commands() const noexcept {return applied_[front_];}
+
+    // snapshots are numbered from 1 in the order of publication. The dirty
+    // chunks of a snapshot are the ones changed since the previous snapshot,
+    // so if a number is skipped, all the chunks should be regarded as dirty.
+    std::uint64_t snapshot_number() const noexcept {return numbers_[front_];}
+
+    // generations simulated so far, including the ones by the other engines.
+    // The statistics of the world count only the chunk engine.
+    std::uint64_t snapshot_generation() const noexcept {return generations_[front_];}
+
+    // the period of the cycle found by the chunk engine, or 0 if not found,
+    // and the phase of the snapshot in it.
+    std::uint64_t snapshot_period() const noexcept {return periods_[front_];}
+    std::uint64_t snapshot_phase()  const noexcept {return phases_ [front_];}
+
+    // number of commands pushed so far
+    std::uint64_t num_commands() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return num_pushed_;
+    }
+
+    // returns the number of the command.
+    std::uint64_t set_cell(const std::int64_t x, const std::int64_t y, const state s)
+    {
+        return this->push([this, x, y, s] {
+            this->engine_->store();
+            const auto x_w = x + world_.origin_x();
+            const auto y_w = y + world_.origin_y();
+            if(0 <= x_w && x_w < static_cast<std::int64_t>(world_.width()) &&
+               0 <= y_w && y_w < static_cast<std::int64_t>(world_.height()))
+            {
+                world_(static_cast<std::int32_t>(x_w), static_cast<std::int32_t>(y_w)) = s;
+                this->engine_->reset();
+                this->is_edited_ = true;
+            }
+        });
+    }
+
+    // writes the pattern with its left-top corner at (x, y)
+    void paste(pattern p, const std::int64_t x, const std::int64_t y)
+    {
+        this->push([this, p = std::move(p), x, y] {
+            this->engine_->store();
+            this->world_.paste(p, x + world_.origin_x(), y + world_.origin_y());
+            this->engine_->reset();
+            this->is_edited_ = true;
+        });
+        return;
+    }
+
+    // sets cells in [x0, x1) x [y0, y1) to s. The world expands to cover
+    // them unless s is vacuum.
+    void fill(const std::int64_t x0, const std::int64_t y0,
+              const std::int64_t x1, const std::int64_t y1, const state s)
+    {
+        this->push([this, x0, y0, x1, y1, s] {
+            this->engine_->store();
+            const auto ox = world_.origin_x();
+            const auto oy = world_.origin_y();
+            if(s == state::vacuum)
+            {
+                this->world_.clear(x0 + ox, y0 + oy, x1 + ox, y1 + oy);
+            }
+            else
+            {
+                this->world_.fill(x0 + ox, y0 + oy, x1 + ox, y1 + oy, s);
+            }
+            this->engine_->reset();
+            this->is_edited_ = true;
+        });
+        return;
+    }
+
+    // makes cells in [x0, x1) x [y0, y1) inside the world. It is idempotent,
+    // so it can be sent until the snapshot covers the region.
+    void cover(const std::int64_t x0, const std::int64_t y0,
+               const std::int64_t x1, const std::int64_t y1)
+    {
+        this->push([this, x0, y0, x1, y1] {
+            this->engine_->store();
+            if(world_.expand_to_cover(x0 + world_.origin_x(), y0 + world_.origin_y(),
+                                      x1 + world_.origin_x(), y1 + world_.origin_y()))
+            {
+                this->engine_->reset();
+                this->is_edited_ = true;
+            }
+        });
+        return;
+    }
+
+    // the number of threads of the current world is kept
+    void replace(world w)
+    {
+        this->push([this, w = std::move(w)]() mutable {
+            const auto num_threads = world_.num_threads();
+            this->world_ = std::move(w);
+            this->world_.set_num_threads(num_threads);
+            this->world_.mark_all_dirty();
+            this->engine_->reset();
+            this->history_.clear();
+            this->is_edited_ = true;
+        });
+        return;
+    }
+
+    // moves to the generation. If it is recorded in the history, the world is
+    // restored from it. If it is newer than the current one, the world is
+    // advanced, skipping the whole periods if a cycle has been found.
+    // Otherwise, the newest recorded generation before it is restored and
+    // advanced to it. If it is older than the history, it moves to the oldest
+    // recorded generation.
+    void seek(const std::uint64_t generation)
+    {
+        this->push([this, generation] {this->seek_to(generation);});
+        return;
+    }
+    void rewind(const std::uint64_t n)
+    {
+        this->push([this, n] {this->seek_to(generation_ - std::min<std::uint64_t>(n, generation_));});
+        return;
+    }
+    void forward(const std::uint64_t n)
+    {
+        this->push([this, n] {this->seek_to(generation_ + n);});
+        return;
+    }
+
+    // bytes used by the history. 0 disables it.
+    void set_history_limit(const std::size_t bytes)
+    {
+        this->push([this, bytes] {
+            this->history_ = history(bytes);
+            this->is_edited_ = true;
+        });
+        return;
+    }
+
+    void step_once()
+    {
+        this->push([this] {this->advance(1);});
+        return;
+    }
+    void set_running(const bool running)
+    {
+        this->push([this, running] {this->is_running_ = running;});
+        return;
+    }
+    // 0 means as fast as possible.
+    void set_steps_per_frame(const std::size_t n)
+    {
+        this->push([this, n] {this->steps_per_frame_ = n;});
+        return;
+    }
+    void use_engine(const engine_kind kind)
+    {
+        this->push([this, kind] {
+            this->engine_->store();
+            this->engine_ = make_engine(kind, world_);
+        });
+        return;
+    }
+    void set_num_threads(const std::size_t n)
+    {
+        this->push([this, n] {this->world_.set_num_threads(n);});
+        return;
+    }
+
+    // packs the world after the commands pushed before and passes it to f on
+    // the simulation thread, e.g. to save it on another thread. Only the
+    // non-empty chunks are copied, and f should not block.
+    void take_snapshot(std::function<void(std::shared_ptr<const packed_world>)> f)
+    {
+        this->push([this, f = std::move(f)] {
+            this->engine_->store();
+            this->world_.update_overview();
+            f(std::make_shared<const packed_world>(pack(world_)));
+        });
+        return;
+    }
+
+    // generations per second, measured on the simulation thread
+    double rate() const noexcept {return rate_.load(std::memory_order_relaxed);}
+
+  private:
+
+    std::uint64_t push(std::function<void()> command)
+    {
+        std::uint64_t number = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            this->commands_.push_back(std::move(command));
+            number = ++num_pushed_;
+        }
+        cv_.notify_one();
+        return number;
+    }
+
+    void run()
+    {
+        std::vector<std::function<void()>> commands;
+        auto next_frame   = clock_type::now();
+        auto rate_start   = next_frame;
+        std::size_t steps = 0;
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        while(true)
+        {
+            const auto has_command = [this] {return is_stopped_ || not commands_.empty();};
+            if(not is_running_)
+            {
+                cv_.wait(lock, has_command);
+            }
+            else if(steps_per_frame_ != 0)
+            {
+                cv_.wait_until(lock, next_frame, has_command);
+            }
+            if(is_stopped_)
+            {
+                return;
+            }
+            std::swap(commands, commands_);
+            lock.unlock();
+
+            const std::size_t generation = generation_;
+            bool is_changed = not commands.empty();
+            if(is_changed)
+            {
+                for(auto& command : commands)
+                {
+                    command();
+                }
+                this->num_applied_ += commands.size();
+                commands.clear();
+            }
+
+            if(is_running_)
+            {
+                const auto now = clock_type::now();
+                if(steps_per_frame_ == 0)
+                {
+                    // runs until the GUI takes the last snapshot or a frame
+                    // passes. The steps given at once double while they fit
+                    // in the frame, so that an engine like hashlife can
+                    // advance many generations at once.
+                    const auto deadline = now + frame;
+                    std::size_t n = 1;
+                    while(true)
+                    {
+                        const auto start = clock_type::now();
+                        this->advance(n);
+                        const auto stop = clock_type::now();
+                        if(deadline <= stop ||
+                           (middle_.load(std::memory_order_acquire) & fresh) == 0)
+                        {
+                            break;
+                        }
+                        if(stop + 2 * (stop - start) < deadline && n < max_steps_at_once)
+                        {
+                            n *= 2;
+                        }
+                    }
+                    is_changed = true;
+                }
+                else if(next_frame <= now)
+                {
+                    this->advance(steps_per_frame_);
+                    next_frame += frame;
+                    if(next_frame < now) // too slow. do not catch up.
+                    {
+                        next_frame = now + frame;
+                    }
+                    is_changed = true;
+                }
+            }
+            if(is_changed)
+            {
+                this->engine_->store();
+                this->publish();
+            }
+
+            steps += generation_ - generation;
+            const auto now = clock_type::now();
+            if(std::chrono::seconds(1) <= now - rate_start || not is_running_)
+            {
+                const double sec = std::chrono::duration<double>(now - rate_start).count();
+                rate_.store(is_running_ ? steps / sec : 0.0, std::memory_order_relaxed);
+                rate_start = now;
+                steps      = 0;
+            }
+            lock.lock();
+        }
+    }
+
+    // advances n generations. Engines other than chunk are written back to
+    // the world by engine::store(). Commands that modify the world call it
+    // first.
+    void advance(const std::size_t n)
+    {
+        if(engine_->kind() == engine_kind::chunk)
+        {
+            // the edited chunks are added to the recorded generation
+            if(this->is_edited_)
+            {
+                this->world_.update_overview();
+                this->history_.record(world_, generation_, true);
+                this->cycle_.clear();
+                this->is_edited_ = false;
+            }
+            const std::uint64_t target = generation_ + n;
+            while(generation_ < target)
+            {
+                // the world after the skip is the same. It is recorded as a
+                // keyframe since it does not follow the last generation.
+                const auto skipped = cycle_.skip(generation_, target);
+                if(skipped != generation_)
+                {
+                    this->generation_ = skipped;
+                    this->history_.record(world_, generation_, false);
+                    continue;
+                }
+                this->world_.update();
+                this->generation_ += 1;
+                this->history_.record(world_, generation_, false);
+                this->cycle_.observe(generation_, world_.hash());
+            }
+            return;
+        }
+        // the recorded generations after an edit are not reached any more
+        if(this->is_edited_)
+        {
+            this->history_.truncate(generation_);
+        }
+        this->generation_ += n;
+        this->engine_->step(n);
+        return;
+    }
+
+    void seek_to(const std::uint64_t generation)
+    {
+        this->engine_->store();
+        if(generation_ < generation && not history_.contains(generation))
+        {
+            this->advance(generation - generation_);
+            return;
+        }
+        if(history_.empty())
+        {
+            return;
+        }
+        const auto target = history_.at_or_before(generation).value_or(history_.oldest());
+        if(target == generation_)
+        {
+            return;
+        }
+        // ports are not recorded in the history
+        const auto num_threads = world_.num_threads();
+        const auto ports       = world_.ports();
+        const auto origin_x    = world_.origin_x();
+        const auto origin_y    = world_.origin_y();
+        this->world_ = history_.restore(target);
+        this->world_.set_num_threads(num_threads);
+        for(auto p : ports)
+        {
+            p.x += world_.origin_x() - origin_x;
+            p.y += world_.origin_y() - origin_y;
+            if(0 <= p.x && p.x < static_cast<std::int64_t>(world_.width()) &&
+               0 <= p.y && p.y < static_cast<std::int64_t>(world_.height()))
+            {
+                this->world_.add_port(std::move(p));
+            }
+        }
+        this->generation_ = target;
+        this->engine_->reset();
+        this->cycle_.clear();
+
+        // the generations skipped over a cycle are not recorded
+        if(target < generation)
+        {
+            this->advance(generation - target);
+        }
+        return;
+    }
+
+    // copies the world into the back buffer and swaps it with the middle one.
+    // Only the chunks dirty since the buffer was written are copied, unless
+    // they are too many to be kept or all of them are dirty.
+    void publish()
+    {
+        this->world_.update_overview(); // edits since the last update
+        this->num_published_ += 1;
+
+        dirty_record record{num_published_, world_.is_all_dirty(), {}};
+        if(not record.is_all)
+        {
+            record.chunks.reserve(world_.num_dirty_chunks());
+            this->world_.for_each_dirty_chunk([&record](const std::size_t x, const std::size_t y) {
+                record.chunks.emplace_back(x, y);
+            });
+        }
+        this->num_logged_chunks_ += record.chunks.size();
+        this->dirty_log_.push_back(std::move(record));
+
+        // records older than all the buffers are not needed. If the records
+        // have more chunks than the world, copying all of them is cheaper.
+        const auto oldest = *std::min_element(written_.begin(), written_.end());
+        const std::size_t num_chunks = (world_.width()  / chunk::width) *
+                                       (world_.height() / chunk::height);
+        while(not dirty_log_.empty() &&
+              (dirty_log_.front().number <= oldest || num_chunks < num_logged_chunks_))
+        {
+            this->num_logged_chunks_ -= dirty_log_.front().chunks.size();
+            this->dirty_log_.pop_front();
+        }
+
+        const auto written = written_[back_];
+        bool is_all = (written == 0 || dirty_log_.empty() ||
+                       written + 1 < dirty_log_.front().number);
+        this->dirty_chunks_.clear();
+        for(const auto& r : dirty_log_)
+        {
+            if(written < r.number && not is_all)
+            {
+                is_all = r.is_all;
+                this->dirty_chunks_.insert(dirty_chunks_.end(), r.chunks.begin(), r.chunks.end());
+            }
+        }
+        if(is_all)
+        {
+            this->world_.publish_to(snapshots_[back_]);
+        }
+        else
+        {
+            this->world_.publish_to(snapshots_[back_], dirty_chunks_);
+        }
+        this->written_    [back_] = num_published_;
+        this->applied_    [back_] = num_applied_;
+        this->numbers_    [back_] = num_published_;
+        this->generations_[back_] = generation_;
+        // an edit breaks the cycle, but the detector is cleared in advance()
+        this->periods_    [back_] = is_edited_ ? 0 : cycle_.period();
+        this->phases_     [back_] = is_edited_ ? 0 : cycle_.phase(generation_);
+        this->world_.clear_dirty();
+        this->back_ = middle_.exchange(back_ | fresh, std::memory_order_acq_rel) & ~fresh;
+        return;
+    }
+
+  private:
+
+    // chunks dirty in a publication
+    struct dirty_record
+    {
+        std::uint64_t number;
+        bool          is_all;
+        std::vector<std::pair<std::size_t, std::size_t>> chunks;
+    };
+
+    static constexpr inline std::uint8_t fresh = 0x04;
+    static constexpr inline std::size_t  max_steps_at_once = std::size_t(1) << 20;
+    static constexpr inline std::size_t  default_history_limit = std::size_t(256) << 20;
+
+    // owned by the simulation thread
+    world                          world_;
+    std::unique_ptr<engine>        engine_;         // bound to world_
+    bool                           is_running_      = true;
+    std::size_t                    steps_per_frame_ = 1;
+    std::size_t                    generation_      = 0;
+    bool                           is_edited_       = true; // since the last record
+    history                        history_{default_history_limit};
+    cycle_detector                 cycle_;
+    std::uint64_t                  num_applied_     = 0;
+    std::uint64_t                  num_published_   = 0;
+    std::deque<dirty_record>       dirty_log_;      // since the oldest buffer
+    std::size_t                    num_logged_chunks_ = 0;
+    std::vector<std::pair<std::size_t, std::size_t>> dirty_chunks_;
+
+    // triple buffer. The middle index has `fresh` if it is not taken yet.
+    std::array<world, 3>         snapshots_;
+    std::array<std::uint64_t, 3> written_{0, 0, 0}; // the publication in each buffer
+    std::array<std::uint64_t, 3> applied_{0, 0, 0};
+    std::array<std::uint64_t, 3> numbers_{0, 0, 0};
+    std::array<std::uint64_t, 3> generations_{0, 0, 0};
+    std::array<std::uint64_t, 3> periods_{0, 0, 0};
+    std::array<std::uint64_t, 3> phases_{0, 0, 0};
+    std::uint8_t                 front_ = 0; // owned by the reader
+    std::uint8_t                 back_  = 2; // owned by the simulation thread
+    std::atomic<std::uint8_t>    middle_{1};
+    std::atomic<double>          rate_{0.0};
+
+    mutable std::mutex                 mtx_;
+    std::condition_variable            cv_;
+    bool                               is_stopped_  = false;
+    std::uint64_t                      num_pushed_  = 0;
+    std::vector<std::function<void()>> commands_;
+    std::thread                        thread_;
+};
+
+} // haywire
+#endif// HAYWIRE_SIMULATOR_HPP
@@ -0,0 +1,603 @@
+#ifndef HAYWIRE_SNAPSHOT_HPP
+#define HAYWIRE_SNAPSHOT_HPP
+#include "world.hpp"
+#include "sparse_world.hpp"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Binary snapshot of a world (.hwb). All the integers are little endian.
+//
+//   header (40 bytes)
+//     magic "HWB\0", version (u16), chunk width (u8), chunk height (u8),
+//     width and height in chunks (u32 x2), number of stored chunks (u64),
+//     offset of the chunk index (u64), offset of the ports (u64, 0 if none)
+//   chunk data
+//   chunk index, sorted by (y, x). each entry (16 bytes) has
+//     x, y (u32 x2), offset (u64)
+//   ports (optional). number of ports (u32) and for each of them
+//     kind (u8), repeat (u8), length of name (u16), length of schedule (u32),
+//     x, y (i64 x2), name, schedule packed in 1 bit per generation
+//
+// Chunks that contain only vacuum are not stored. A chunk is encoded in one of
+//   - packed: 2 bits per cell, 16 bytes
+//   - runs:   a byte per run. the lower 2 bits are the state and the upper
+//             6 bits are the length - 1. shorter than 16 bytes.
+// whichever is smaller. The size of a chunk is the distance to the next one,
+// so the encoding is determined by the size.
+
+namespace haywire
+{
+
+namespace snapshot_format
+{
+inline constexpr std::array<char, 4> magic{{'H', 'W', 'B', '\0'}};
+inline constexpr std::uint16_t version      = 1;
+inline constexpr std::size_t   header_size  = 40;
+inline constexpr std::size_t   entry_size   = 16;
+inline constexpr std::size_t   packed_size  = chunk::width * chunk::height / 4;
+
+template<typename T>
+void put(std::vector<char>& buf, const std::size_t pos, const T value) noexcept
+{
+    for(std::size_t i=0; i<sizeof(T); ++i)
+    {
+        buf[pos + i] = static_cast<char>((static_cast<std::uint64_t>(value) >> (8 * i)) & 0xFF);
+    }
+    return;
+}
+template<typename T>
+T get(const char* ptr) noexcept
+{
+    std::uint64_t value = 0;
+    for(std::size_t i=0; i<sizeof(T); ++i)
+    {
+        value |= static_cast<std::uint64_t>(static_cast<unsigned char>(ptr[i])) << (8 * i);
+    }
+    return static_cast<T>(value);
+}
+
+inline void encode(const chunk& ch, std::vector<char>& out)
+{
+    out.clear();
+    for(std::size_t i=0; i<ch.cells.size(); )
+    {
+        const state s = ch.cells[i];
+        std::size_t len = 1;
+        while(i + len < ch.cells.size() && ch.cells[i + len] == s)
+        {
+            ++len;
+        }
+        out.push_back(static_cast<char>(((len - 1) << 2) | s));
+        i += len;
+    }
+    if(out.size() < packed_size)
+    {
+        return;
+    }
+
+    out.assign(packed_size, 0);
+    for(std::size_t i=0; i<ch.cells.size(); ++i)
+    {
+        out[i / 4] = static_cast<char>(out[i / 4] | (ch.cells[i] << (2 * (i % 4))));
+    }
+    return;
+}
+
+inline void decode(const char* data, const std::size_t size, chunk& ch)
+{
+    if(size == packed_size)
+    {
+        for(std::size_t i=0; i<ch.cells.size(); ++i)
+        {
+            ch.cells[i] = static_cast<state>(
+                (static_cast<unsigned char>(data[i / 4]) >> (2 * (i % 4))) & 0x03);
+        }
+        return;
+    }
+    if(size < packed_size)
+    {
+        std::size_t i = 0;
+        for(std::size_t j=0; j<size; ++j)
+        {
+            const auto byte = static_cast<unsigned char>(data[j]);
+            const std::size_t len = (byte >> 2) + 1;
+            if(ch.cells.size() < i + len)
+            {
+                throw std::runtime_error("haywire::snapshot: too long runs in a chunk");
+            }
+            std::fill_n(ch.cells.begin() + i, len, static_cast<state>(byte & 0x03));
+            i += len;
+        }
+        if(i != ch.cells.size())
+        {
+            throw std::runtime_error("haywire::snapshot: too short runs in a chunk");
+        }
+        return;
+    }
+    throw std::runtime_error("haywire::snapshot: invalid size of a chunk");
+}
+} // snapshot_format
+
+// the non-empty chunks of a world in the order of (y, x), and its ports. It
+// holds only the footprint of the world, e.g. to save it on another thread.
+struct packed_world
+{
+    std::uint32_t      width_chunk  = 0;
+    std::uint32_t      height_chunk = 0;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> positions; // (x_chk, y_chk)
+    std::vector<chunk> chunks;
+    std::vector<port>  ports;
+};
+
+// non-empty chunks are found through the overview of the world, so it
+// should be up to date (see world::update_overview()).
+inline packed_world pack(const world& w)
+{
+    packed_world retval;
+    retval.width_chunk  = static_cast<std::uint32_t>(w.width()  / chunk::width);
+    retval.height_chunk = static_cast<std::uint32_t>(w.height() / chunk::height);
+    w.for_each_nonempty_chunk([&retval](const std::size_t x, const std::size_t y) {
+        retval.positions.emplace_back(static_cast<std::uint32_t>(x),
+                                      static_cast<std::uint32_t>(y));
+    });
+    std::sort(retval.positions.begin(), retval.positions.end(),
+        [](const auto& lhs, const auto& rhs) noexcept {
+            return std::make_pair(lhs.second, lhs.first) < std::make_pair(rhs.second, rhs.first);
+        });
+    retval.chunks.reserve(retval.positions.size());
+    for(const auto& [x, y] : retval.positions)
+    {
+        retval.chunks.push_back(w.chunk_at(x, y, std::nothrow));
+    }
+    retval.ports = w.ports();
+    return retval;
+}
+
+// chunk (bounds().x0, bounds().y0) is placed at (0, 0).
+inline packed_world pack(const sparse_world& w)
+{
+    const auto b = w.bounds();
+    if(std::numeric_limits<std::uint32_t>::max() < b.x1 - b.x0 ||
+       std::numeric_limits<std::uint32_t>::max() < b.y1 - b.y0)
+    {
+        throw std::runtime_error("haywire::pack: too large sparse world");
+    }
+    packed_world retval;
+    retval.width_chunk  = static_cast<std::uint32_t>(b.x1 - b.x0);
+    retval.height_chunk = static_cast<std::uint32_t>(b.y1 - b.y0);
+    std::vector<std::pair<std::pair<std::uint32_t, std::uint32_t>, const chunk*>> found;
+    w.for_each_chunk([&found, &b](const std::int64_t x, const std::int64_t y, const chunk& ch) {
+        found.emplace_back(std::make_pair(static_cast<std::uint32_t>(x - b.x0),
+                                          static_cast<std::uint32_t>(y - b.y0)), &ch);
+    });
+    std::sort(found.begin(), found.end(), [](const auto& lhs, const auto& rhs) noexcept {
+        return std::make_pair(lhs.first.second, lhs.first.first) <
+               std::make_pair(rhs.first.second, rhs.first.first);
+    });
+    retval.positions.reserve(found.size());
+    retval.chunks   .reserve(found.size());
+    for(const auto& [pos, ch] : found)
+    {
+        retval.positions.push_back(pos);
+        retval.chunks   .push_back(*ch);
+    }
+    return retval;
+}
+
+namespace snapshot_format
+{
+// writes chunks one by one. Only the index is kept in memory.
+// for_each_chunk(f) calls f(x, y, chunk) for each chunk to be stored in the
+// order of (y, x).
+template<typename ForEachChunk>
+void write(const std::string& fname, const std::uint32_t width_chunk,
+           const std::uint32_t height_chunk, ForEachChunk&& for_each_chunk,
+           const std::vector<port>& ports)
+{
+    std::ofstream ofs(fname, std::ios::binary);
+    if(not ofs.good())
+    {
+        throw std::runtime_error("haywire::write_snapshot: file open error: " + fname);
+    }
+    std::vector<char> header(header_size, 0);
+    ofs.write(header.data(), header.size()); // written later
+
+    std::vector<char> index, buf;
+    std::uint64_t offset = header_size;
+    std::uint64_t count  = 0;
+    for_each_chunk([&](const std::uint32_t x, const std::uint32_t y, const chunk& ch) {
+        encode(ch, buf);
+        ofs.write(buf.data(), buf.size());
+
+        const std::size_t pos = index.size();
+        index.resize(pos + entry_size, 0);
+        put<std::uint32_t>(index, pos,      x);
+        put<std::uint32_t>(index, pos +  4, y);
+        put<std::uint64_t>(index, pos +  8, offset);
+        offset += buf.size();
+        count  += 1;
+    });
+    ofs.write(index.data(), index.size());
+
+    std::uint64_t ports_offset = 0;
+    if(not ports.empty())
+    {
+        ports_offset = offset + index.size();
+        buf.assign(4, 0);
+        put<std::uint32_t>(buf, 0, ports.size());
+        for(const auto& p : ports)
+        {
+            if(0xFFFFu < p.name.size())
+            {
+                throw std::runtime_error("haywire::write_snapshot: too long name of a port");
+            }
+            const std::size_t pos = buf.size();
+            buf.resize(pos + 24, 0);
+            put<std::uint8_t >(buf, pos,      static_cast<std::uint8_t>(p.kind));
+            put<std::uint8_t >(buf, pos +  1, p.repeat);
+            put<std::uint16_t>(buf, pos +  2, p.name.size());
+            put<std::uint32_t>(buf, pos +  4, p.schedule.size());
+            put<std::uint64_t>(buf, pos +  8, p.x);
+            put<std::uint64_t>(buf, pos + 16, p.y);
+            buf.insert(buf.end(), p.name.begin(), p.name.end());
+
+            const std::size_t bits = buf.size();
+            buf.resize(bits + (p.schedule.size() + 7) / 8, 0);
+            for(std::size_t i=0; i<p.schedule.size(); ++i)
+            {
+                buf[bits + i / 8] = static_cast<char>(buf[bits + i / 8] |
+                                                      ((p.schedule[i] == '1') << (i % 8)));
+            }
+        }
+        ofs.write(buf.data(), buf.size());
+    }
+
+    std::copy(magic.begin(), magic.end(), header.begin());
+    put<std::uint16_t>(header,  4, version);
+    put<std::uint8_t >(header,  6, chunk::width);
+    put<std::uint8_t >(header,  7, chunk::height);
+    put<std::uint32_t>(header,  8, width_chunk);
+    put<std::uint32_t>(header, 12, height_chunk);
+    put<std::uint64_t>(header, 16, count);
+    put<std::uint64_t>(header, 24, offset);
+    put<std::uint64_t>(header, 32, ports_offset);
+    ofs.seekp(0);
+    ofs.write(header.data(), header.size());
+    ofs.close(); // errors in flushing the buffer are found only here
+    if(ofs.fail())
+    {
+        throw std::runtime_error("haywire::write_snapshot: write error: " + fname);
+    }
+    return;
+}
+} // snapshot_format
+
+inline void write_snapshot(const std::string& fname, const world& w)
+{
+    const std::uint32_t width_chunk  = w.width()  / chunk::width;
+    const std::uint32_t height_chunk = w.height() / chunk::height;
+    snapshot_format::write(fname, width_chunk, height_chunk, [&](auto&& f) {
+        for(std::uint32_t y=0; y<height_chunk; ++y)
+        {
+            for(std::uint32_t x=0; x<width_chunk; ++x)
+            {
+                const auto& ch = w.chunk_at(x, y, std::nothrow);
+                if(std::any_of(ch.cells.begin(), ch.cells.end(),
+                        [](const state s) noexcept {return s != state::vacuum;}))
+                {
+                    f(x, y, ch);
+                }
+            }
+        }
+    }, w.ports());
+    return;
+}
+inline void write_snapshot(const std::string& fname, const packed_world& w)
+{
+    snapshot_format::write(fname, w.width_chunk, w.height_chunk, [&w](auto&& f) {
+        for(std::size_t i=0; i<w.chunks.size(); ++i)
+        {
+            f(w.positions[i].first, w.positions[i].second, w.chunks[i]);
+        }
+    }, w.ports);
+    return;
+}
+inline void write_snapshot(const std::string& fname, const sparse_world& w)
+{
+    write_snapshot(fname, pack(w));
+    return;
+}
+
+// read-only view of a whole file. It is memory-mapped if possible, or read
+// into memory otherwise.
+struct mapped_file
+{
+    explicit mapped_file(const std::string& fname)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = ::open(fname.c_str(), O_RDONLY);
+        if(fd != -1)
+        {
+            struct stat st;
+            if(::fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(addr != MAP_FAILED)
+                {
+                    this->data_ = static_cast<const char*>(addr);
+                    this->size_ = st.st_size;
+                }
+            }
+            ::close(fd);
+            if(data_ != nullptr)
+            {
+                return;
+            }
+        }
+#endif
+        std::ifstream ifs(fname, std::ios::binary);
+        if(not ifs.good())
+        {
+            throw std::runtime_error("haywire::mapped_file: file open error: " + fname);
+        }
+        this->buffer_.assign(std::istreambuf_iterator<char>(ifs),
+                             std::istreambuf_iterator<char>());
+        this->data_ = buffer_.data();
+        this->size_ = buffer_.size();
+    }
+    ~mapped_file()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if(buffer_.empty() && data_ != nullptr)
+        {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+    }
+    mapped_file(const mapped_file&) = delete;
+    mapped_file(mapped_file&&)      = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file& operator=(mapped_file&&)      = delete;
+
+    const char* data() const noexcept {return data_;}
+    std::size_t size() const noexcept {return size_;}
+
+  private:
+    const char*       data_ = nullptr;
+    std::size_t       size_ = 0;
+    std::vector<char> buffer_; // used if mmap is not available
+};
+
+// Reads a snapshot. Only the header is read on construction, and chunks are
+// decoded when they are loaded, so a region can be read without touching the
+// rest of the file.
+struct snapshot_reader
+{
+    explicit snapshot_reader(const std::string& fname): file_(fname)
+    {
+        namespace fmt = snapshot_format;
+        const char* ptr = file_.data();
+        if(file_.size() < fmt::header_size ||
+           not std::equal(fmt::magic.begin(), fmt::magic.end(), ptr))
+        {
+            throw std::runtime_error("haywire::snapshot_reader: not a snapshot: " + fname);
+        }
+        if(fmt::get<std::uint16_t>(ptr + 4) != fmt::version ||
+           fmt::get<std::uint8_t >(ptr + 6) != chunk::width ||
+           fmt::get<std::uint8_t >(ptr + 7) != chunk::height)
+        {
+            throw std::runtime_error("haywire::snapshot_reader: unsupported "
+                                     "version or chunk size: " + fname);
+        }
+        this->width_chunk_  = fmt::get<std::uint32_t>(ptr +  8);
+        this->height_chunk_ = fmt::get<std::uint32_t>(ptr + 12);
+        this->num_chunks_   = fmt::get<std::uint64_t>(ptr + 16);
+        this->index_offset_ = fmt::get<std::uint64_t>(ptr + 24);
+        this->ports_offset_ = fmt::get<std::uint64_t>(ptr + 32);
+        if(index_offset_ > file_.size() ||
+           num_chunks_ > (file_.size() - index_offset_) / fmt::entry_size ||
+           ports_offset_ > file_.size())
+        {
+            throw std::runtime_error("haywire::snapshot_reader: truncated: " + fname);
+        }
+        if(ports_offset_ != 0)
+        {
+            this->read_ports(fname);
+        }
+    }
+
+    std::size_t width()      const noexcept {return width_chunk_  * chunk::width;}
+    std::size_t height()     const noexcept {return height_chunk_ * chunk::height;}
+    std::size_t num_chunks() const noexcept {return num_chunks_;}
+
+    // in the coordinates of the whole world
+    const std::vector<port>& ports() const noexcept {return ports_;}
+
+    world load() const
+    {
+        return this->load(0, 0, width_chunk_, height_chunk_);
+    }
+
+    // reads chunks in [x0, x1) x [y0, y1). Chunk (x0, y0) is placed at (0, 0).
+    world load(const std::size_t x0, const std::size_t y0,
+               const std::size_t x1, const std::size_t y1) const
+    {
+        if(x1 < x0 || y1 < y0 || width_chunk_ < x1 || height_chunk_ < y1)
+        {
+            throw std::out_of_range("haywire::snapshot_reader::load: region out of range");
+        }
+        world w((x1 - x0) * chunk::width, (y1 - y0) * chunk::height);
+        for(std::size_t y=y0; y<y1; ++y)
+        {
+            for(auto i = this->lower_bound(x0, y); i < num_chunks_; ++i)
+            {
+                const auto e = this->entry(i);
+                if(e.y != y || x1 <= e.x) {break;}
+                this->decode(e, w.chunk_at(e.x - x0, e.y - y0, std::nothrow));
+            }
+        }
+        // ports in the region
+        for(auto p : ports_)
+        {
+            p.x -= static_cast<std::int64_t>(x0 * chunk::width);
+            p.y -= static_cast<std::int64_t>(y0 * chunk::height);
+            if(0 <= p.x && p.x < static_cast<std::int64_t>(w.width()) &&
+               0 <= p.y && p.y < static_cast<std::int64_t>(w.height()))
+            {
+                w.add_port(std::move(p));
+            }
+        }
+        return w;
+    }
+
+    // reads all the chunks into a sparse world without allocating the whole
+    // world. Ports are not read; see ports().
+    sparse_world load_sparse() const
+    {
+        sparse_world w;
+        chunk ch;
+        for(std::size_t i=0; i<num_chunks_; ++i)
+        {
+            const auto e = this->entry(i);
+            this->decode(e, ch);
+            w.set_chunk(e.x, e.y, ch);
+        }
+        return w;
+    }
+
+  private:
+
+    struct entry_type
+    {
+        std::uint32_t x, y;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    entry_type entry(const std::size_t i) const noexcept
+    {
+        namespace fmt = snapshot_format;
+        const char* ptr = file_.data() + index_offset_ + i * fmt::entry_size;
+        const auto offset = fmt::get<std::uint64_t>(ptr + 8);
+        const auto next   = (i + 1 < num_chunks_) ?
+            fmt::get<std::uint64_t>(ptr + fmt::entry_size + 8) : index_offset_;
+        return entry_type{fmt::get<std::uint32_t>(ptr),
+                          fmt::get<std::uint32_t>(ptr + 4),
+                          offset, next - offset};
+    }
+
+    // the first entry that is not less than (x, y) in row-major order
+    std::size_t lower_bound(const std::size_t x, const std::size_t y) const noexcept
+    {
+        std::size_t first = 0, len = num_chunks_;
+        while(len != 0)
+        {
+            const std::size_t half = len / 2;
+            const auto e = this->entry(first + half);
+            if(e.y < y || (e.y == y && e.x < x))
+            {
+                first += half + 1;
+                len   -= half + 1;
+            }
+            else
+            {
+                len = half;
+            }
+        }
+        return first;
+    }
+
+    void read_ports(const std::string& fname)
+    {
+        namespace fmt = snapshot_format;
+        const char* ptr  = file_.data() + ports_offset_;
+        const char* last = file_.data() + file_.size();
+        const auto broken = [&fname] {
+            return std::runtime_error("haywire::snapshot_reader: broken ports: " + fname);
+        };
+        if(last - ptr < 4)
+        {
+            throw broken();
+        }
+        const auto count = fmt::get<std::uint32_t>(ptr);
+        ptr += 4;
+        for(std::uint32_t i=0; i<count; ++i)
+        {
+            if(last - ptr < 24)
+            {
+                throw broken();
+            }
+            const auto kind = fmt::get<std::uint8_t>(ptr);
+            if(kind != static_cast<std::uint8_t>(port::kind_type::input) &&
+               kind != static_cast<std::uint8_t>(port::kind_type::probe))
+            {
+                throw broken();
+            }
+            port p;
+            p.kind   = static_cast<port::kind_type>(kind);
+            p.repeat = fmt::get<std::uint8_t>(ptr + 1) != 0;
+            const std::size_t name_size = fmt::get<std::uint16_t>(ptr + 2);
+            const std::size_t bits      = fmt::get<std::uint32_t>(ptr + 4);
+            p.x = static_cast<std::int64_t>(fmt::get<std::uint64_t>(ptr +  8));
+            p.y = static_cast<std::int64_t>(fmt::get<std::uint64_t>(ptr + 16));
+            ptr += 24;
+            if(static_cast<std::size_t>(last - ptr) < name_size + (bits + 7) / 8)
+            {
+                throw broken();
+            }
+            p.name.assign(ptr, name_size);
+            ptr += name_size;
+            p.schedule.resize(bits);
+            for(std::size_t j=0; j<bits; ++j)
+            {
+                p.schedule[j] = ((static_cast<unsigned char>(ptr[j / 8]) >> (j % 8)) & 1u) ? '1' : '0';
+            }
+            ptr += (bits + 7) / 8;
+            ports_.push_back(std::move(p));
+        }
+        return;
+    }
+
+    void decode(const entry_type& e, chunk& ch) const
+    {
+        if(width_chunk_ <= e.x || height_chunk_ <= e.y ||
+           e.offset < snapshot_format::header_size || index_offset_ < e.offset ||
+           index_offset_ - e.offset < e.size)
+        {
+            throw std::runtime_error("haywire::snapshot_reader: broken chunk index");
+        }
+        snapshot_format::decode(file_.data() + e.offset, e.size, ch);
+        return;
+    }
+
+  private:
+    mapped_file   file_;
+    std::size_t   width_chunk_, height_chunk_;
+    std::uint64_t num_chunks_;
+    std::uint64_t index_offset_;
+    std::uint64_t ports_offset_;
+    std::vector<port> ports_;
+};
+
+inline world read_snapshot(const std::string& fname)
+{
+    return snapshot_reader(fname).load();
+}
+
+} // haywire
+#endif// HAYWIRE_SNAPSHOT_HPP
@@ -0,0 +1,458 @@
+#ifndef HAYWIRE_SPARSE_WORLD_HPP
+#define HAYWIRE_SPARSE_WORLD_HPP
+#include "world.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace haywire
+{
+
+// chunk coordinates in a sparse_world
+struct chunk_key
+{
+    std::int64_t x, y;
+
+    bool operator==(const chunk_key& other) const noexcept
+    {
+        return x == other.x && y == other.y;
+    }
+    bool operator!=(const chunk_key& other) const noexcept
+    {
+        return !(*this == other);
+    }
+};
+
+struct chunk_key_hash
+{
+    std::size_t operator()(const chunk_key& k) const noexcept
+    {
+        // splitmix64 finalizer. neighboring chunks spread over the buckets.
+        std::uint64_t h = static_cast<std::uint64_t>(k.x) * 0x9E3779B97F4A7C15ull ^
+                          static_cast<std::uint64_t>(k.y);
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        return static_cast<std::size_t>(h ^ (h >> 31));
+    }
+};
+
+// [x0, x1) x [y0, y1) in chunks
+struct chunk_bounds
+{
+    std::int64_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+};
+
+// An unbounded world that stores only non-empty chunks in a hash map keyed by
+// signed 64-bit chunk coordinates. Absent chunks are vacuum, and a chunk that
+// becomes empty is released, so the memory follows the footprint of the
+// circuit and the world never expands.
+//
+// It is the storage of haywire-headless --engine=sparse: patterns and
+// snapshots are read into it and written from it directly. As an engine of
+// the GUI, it is built from the dense world that is drawn, and store() writes
+// the changes back into it.
+struct sparse_world
+{
+    using key_type = chunk_key;
+
+    sparse_world() = default;
+
+    // chunk (0, 0) of the world is placed at chunk (0, 0).
+    explicit sparse_world(const world& w)
+    {
+        const std::size_t width_chunk  = w.width()  / chunk::width;
+        const std::size_t height_chunk = w.height() / chunk::height;
+        for(std::size_t y=0; y<height_chunk; ++y)
+        {
+            for(std::size_t x=0; x<width_chunk; ++x)
+            {
+                const auto& ch = w.chunk_at(x, y, std::nothrow);
+                if(not is_empty(ch))
+                {
+                    const auto slot = this->insert(key_type{static_cast<std::int64_t>(x),
+                                                            static_cast<std::int64_t>(y)});
+                    chunks_[slot] = ch;
+                    this->activate(slot);
+                }
+            }
+        }
+    }
+
+    state operator()(const std::int64_t x, const std::int64_t y) const noexcept
+    {
+        const auto found = index_.find(key_type{floor_div(x, chunk::width),
+                                                floor_div(y, chunk::height)});
+        if(found == index_.end())
+        {
+            return state::vacuum;
+        }
+        return chunks_[found->second](floor_mod(x, chunk::width),
+                                      floor_mod(y, chunk::height));
+    }
+
+    void set(const std::int64_t x, const std::int64_t y, const state s)
+    {
+        const key_type key{floor_div(x, chunk::width), floor_div(y, chunk::height)};
+        const auto found = index_.find(key);
+        if(found == index_.end() && s == state::vacuum)
+        {
+            return;
+        }
+        const auto slot = (found == index_.end()) ? this->insert(key) : found->second;
+        chunks_[slot](floor_mod(x, chunk::width), floor_mod(y, chunk::height)) = s;
+
+        if(s == state::vacuum && is_empty(chunks_[slot]))
+        {
+            this->erase(slot);
+        }
+        else
+        {
+            this->activate(slot);
+            this->mark_unstored(slot);
+        }
+        return;
+    }
+
+    // replaces a whole chunk. An empty chunk is released.
+    void set_chunk(const std::int64_t x_chk, const std::int64_t y_chk, const chunk& ch)
+    {
+        const key_type key{x_chk, y_chk};
+        const auto found = index_.find(key);
+        if(is_empty(ch))
+        {
+            if(found != index_.end())
+            {
+                this->erase(found->second);
+            }
+            return;
+        }
+        const auto slot = (found == index_.end()) ? this->insert(key) : found->second;
+        chunks_[slot] = ch;
+        this->activate(slot);
+        this->mark_unstored(slot);
+        return;
+    }
+
+    // calls f(x_chk, y_chk, chunk) for each non-empty chunk in no particular
+    // order.
+    template<typename F>
+    void for_each_chunk(F&& f) const
+    {
+        for(const auto& [key, slot] : index_)
+        {
+            f(key.x, key.y, chunks_[slot]);
+        }
+        return;
+    }
+
+    // the smallest rectangle that covers all the chunks. empty if there is no
+    // chunk.
+    chunk_bounds bounds() const noexcept
+    {
+        if(index_.empty())
+        {
+            return chunk_bounds{};
+        }
+        chunk_bounds b{std::numeric_limits<std::int64_t>::max(),
+                       std::numeric_limits<std::int64_t>::max(),
+                       std::numeric_limits<std::int64_t>::min(),
+                       std::numeric_limits<std::int64_t>::min()};
+        for(const auto& kv : index_)
+        {
+            b.x0 = std::min(b.x0, kv.first.x);
+            b.y0 = std::min(b.y0, kv.first.y);
+            b.x1 = std::max(b.x1, kv.first.x + 1);
+            b.y1 = std::max(b.y1, kv.first.y + 1);
+        }
+        return b;
+    }
+
+    // a dense world of bounds(). chunk (bounds().x0, bounds().y0) is placed at
+    // (0, 0).
+    world to_world() const
+    {
+        const auto b = this->bounds();
+        world w(static_cast<std::size_t>(b.x1 - b.x0) * chunk::width,
+                static_cast<std::size_t>(b.y1 - b.y0) * chunk::height);
+        this->for_each_chunk([&w, &b](const std::int64_t x, const std::int64_t y, const chunk& ch) {
+            w.chunk_at(static_cast<std::uint32_t>(x - b.x0),
+                       static_cast<std::uint32_t>(y - b.y0), std::nothrow) = ch;
+        });
+        w.recount();
+        return w;
+    }
+
+    // the size is the one of bounds(). The cells are counted, so it takes
+    // time proportional to the footprint.
+    world_statistics statistics() const noexcept
+    {
+        world_statistics stats;
+        this->for_each_chunk([&stats](std::int64_t, std::int64_t, const chunk& ch) {
+            for(const auto s : ch.cells)
+            {
+                stats.num_heads += (s == state::head);
+                stats.num_tails += (s == state::tail);
+                stats.num_wires += (s == state::wire);
+            }
+        });
+        const auto b = this->bounds();
+        stats.num_active_chunks = active_.size();
+        stats.width             = static_cast<std::size_t>(b.x1 - b.x0) * chunk::width;
+        stats.height            = static_cast<std::size_t>(b.y1 - b.y0) * chunk::height;
+        stats.memory            = this->memory_usage();
+        return stats;
+    }
+
+    void update()
+    {
+        // chunks that have head or tail and their neighbors may change.
+        // an absent chunk is vacuum and remains vacuum.
+        targets_.clear();
+        for(const auto slot : active_)
+        {
+            flags_[slot] &= ~flag_active;
+            if((flags_[slot] & flag_used) == 0) {continue;} // already released
+
+            const auto [x_chk, y_chk] = keys_[slot];
+            for(std::int64_t dy=-1; dy<=1; ++dy)
+            {
+                for(std::int64_t dx=-1; dx<=1; ++dx)
+                {
+                    const auto found = index_.find(key_type{x_chk + dx, y_chk + dy});
+                    if(found != index_.end() &&
+                       (flags_[found->second] & flag_target) == 0)
+                    {
+                        flags_[found->second] |= flag_target;
+                        targets_.push_back(found->second);
+                    }
+                }
+            }
+        }
+
+        results_.resize(targets_.size());
+        for(std::size_t i=0; i<targets_.size(); ++i)
+        {
+            this->update_chunk(targets_[i], results_[i]);
+        }
+
+        active_.clear();
+        for(std::size_t i=0; i<targets_.size(); ++i)
+        {
+            const auto slot = targets_[i];
+            flags_[slot] &= ~flag_target;
+            if(chunks_[slot].cells != results_[i].cells)
+            {
+                chunks_[slot] = results_[i];
+                this->mark_unstored(slot);
+            }
+            if(has_electron(chunks_[slot]))
+            {
+                this->activate(slot);
+            }
+        }
+        return;
+    }
+
+    // writes the chunks changed since the construction or the last store()
+    // in the region covered by the world. The world must be the one it was
+    // constructed from, with the changes stored so far.
+    void store(world& w)
+    {
+        const chunk vacuum;
+        const auto write = [&w](const key_type key, const chunk& next) {
+            const auto [x, y] = key;
+            if(x < 0 || static_cast<std::int64_t>(w.width()  / chunk::width)  <= x ||
+               y < 0 || static_cast<std::int64_t>(w.height() / chunk::height) <= y)
+            {
+                return;
+            }
+            const auto x_chk = static_cast<std::uint32_t>(x);
+            const auto y_chk = static_cast<std::uint32_t>(y);
+            if(std::as_const(w).chunk_at(x_chk, y_chk, std::nothrow).cells != next.cells)
+            {
+                w.chunk_at(x_chk, y_chk, std::nothrow) = next;
+            }
+            return;
+        };
+        // a released chunk might have been inserted again
+        for(const auto key : released_)
+        {
+            if(index_.count(key) == 0)
+            {
+                write(key, vacuum);
+            }
+        }
+        released_.clear();
+        for(const auto slot : unstored_)
+        {
+            if((flags_[slot] & flag_unstored) != 0)
+            {
+                flags_[slot] &= ~flag_unstored;
+                write(keys_[slot], chunks_[slot]);
+            }
+        }
+        unstored_.clear();
+        return;
+    }
+
+    std::size_t num_chunks()        const noexcept {return index_.size();}
+    std::size_t num_active_chunks() const noexcept {return active_.size();}
+
+    // bytes held by chunks, including released ones kept for reuse
+    std::size_t memory_usage() const noexcept
+    {
+        return chunks_.capacity() * sizeof(chunk) +
+               index_.size() * (sizeof(key_type) + sizeof(std::size_t));
+    }
+
+  private:
+
+    static std::int64_t floor_div(const std::int64_t x, const std::int64_t d) noexcept
+    {
+        return (x % d < 0) ? x / d - 1 : x / d; // no overflow at the minimum
+    }
+    static std::int64_t floor_mod(const std::int64_t x, const std::int64_t d) noexcept
+    {
+        return x - floor_div(x, d) * d;
+    }
+
+    static bool is_empty(const chunk& ch) noexcept
+    {
+        return std::all_of(ch.cells.begin(), ch.cells.end(),
+                [](const state s) noexcept {return s == state::vacuum;});
+    }
+    static bool has_electron(const chunk& ch) noexcept
+    {
+        return std::any_of(ch.cells.begin(), ch.cells.end(),
+                [](const state s) noexcept {return s == state::head || s == state::tail;});
+    }
+
+    std::size_t insert(const key_type key)
+    {
+        std::size_t slot;
+        if(not free_.empty())
+        {
+            slot = free_.back();
+            free_.pop_back();
+            chunks_[slot] = chunk{};
+            keys_  [slot] = key;
+            flags_ [slot] = flag_used;
+        }
+        else
+        {
+            slot = chunks_.size();
+            chunks_.emplace_back();
+            keys_  .push_back(key);
+            flags_ .push_back(flag_used);
+        }
+        index_.emplace(key, slot);
+        return slot;
+    }
+    void erase(const std::size_t slot)
+    {
+        index_.erase(keys_[slot]);
+        flags_[slot] &= ~(flag_used | flag_unstored);
+        free_.push_back(slot);
+        released_.push_back(keys_[slot]);
+        return;
+    }
+
+    void activate(const std::size_t slot)
+    {
+        if((flags_[slot] & flag_active) == 0)
+        {
+            flags_[slot] |= flag_active;
+            active_.push_back(slot);
+        }
+        return;
+    }
+    void mark_unstored(const std::size_t slot)
+    {
+        if((flags_[slot] & flag_unstored) == 0)
+        {
+            flags_[slot] |= flag_unstored;
+            unstored_.push_back(slot);
+        }
+        return;
+    }
+
+    void update_chunk(const std::size_t slot, chunk& next) const
+    {
+        constexpr std::int32_t w = chunk::width;
+        constexpr std::int32_t h = chunk::height;
+
+        // 3x3 neighborhood of chunks. nullptr if it is vacuum.
+        const auto [x_chk, y_chk] = keys_[slot];
+        std::array<const chunk*, 9> around;
+        for(std::int64_t dy=-1; dy<=1; ++dy)
+        {
+            for(std::int64_t dx=-1; dx<=1; ++dx)
+            {
+                const auto found = index_.find(key_type{x_chk + dx, y_chk + dy});
+                around[(dy+1) * 3 + (dx+1)] =
+                    (found == index_.end()) ? nullptr : &chunks_[found->second];
+            }
+        }
+        const auto at = [&around](const std::int32_t x, const std::int32_t y) noexcept {
+            const std::int32_t cx = (x < 0) ? 0 : (x < w ? 1 : 2);
+            const std::int32_t cy = (y < 0) ? 0 : (y < h ? 1 : 2);
+            const chunk* ch = around[cy * 3 + cx];
+            if(ch == nullptr) {return state::vacuum;}
+            return (*ch)((x + w) % w, (y + h) % h);
+        };
+
+        const auto& self = chunks_[slot];
+        for(std::int32_t y=0; y<h; ++y)
+        {
+            for(std::int32_t x=0; x<w; ++x)
+            {
+                switch(self(x, y))
+                {
+                    case state::vacuum: {next(x, y) = state::vacuum; break;}
+                    case state::head:   {next(x, y) = state::tail;   break;}
+                    case state::tail:   {next(x, y) = state::wire;   break;}
+                    case state::wire:
+                    {
+                        const int count =
+                            static_cast<int>(at(x-1, y-1) == state::head) +
+                            static_cast<int>(at(x  , y-1) == state::head) +
+                            static_cast<int>(at(x+1, y-1) == state::head) +
+                            static_cast<int>(at(x-1, y  ) == state::head) +
+                            static_cast<int>(at(x+1, y  ) == state::head) +
+                            static_cast<int>(at(x-1, y+1) == state::head) +
+                            static_cast<int>(at(x  , y+1) == state::head) +
+                            static_cast<int>(at(x+1, y+1) == state::head);
+                        next(x, y) = (count == 1 || count == 2) ? state::head : state::wire;
+                        break;
+                    }
+                }
+            }
+        }
+        return;
+    }
+
+  private:
+
+    static constexpr inline std::uint8_t flag_used     = 0x01;
+    static constexpr inline std::uint8_t flag_active   = 0x02;
+    static constexpr inline std::uint8_t flag_target   = 0x04;
+    static constexpr inline std::uint8_t flag_unstored = 0x08; // changed since store()
+
+    std::unordered_map<key_type, std::size_t, chunk_key_hash> index_; // chunk -> slot
+    std::vector<chunk>        chunks_; // slots
+    std::vector<key_type>     keys_;   // slot -> chunk
+    std::vector<std::uint8_t> flags_;
+    std::vector<std::size_t>  free_;   // released slots
+    std::vector<std::size_t>  active_;
+    std::vector<std::size_t>  targets_;
+    std::vector<chunk>        results_;
+    std::vector<std::size_t>  unstored_; // slots changed since store()
+    std::vector<key_type>     released_; // chunks released since store()
+};
+
+} // haywire
+#endif// HAYWIRE_SPARSE_WORLD_HPP
@@ -0,0 +1,149 @@
+#ifndef HAYWIRE_TESTBENCH_HPP
+#define HAYWIRE_TESTBENCH_HPP
+#include "world.hpp"
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace haywire
+{
+
+// a bit per generation, 1 if the probed cell is a head. Tails are not stored
+// because a head always becomes a tail in the next generation.
+struct probe_trace
+{
+    std::string                name;
+    std::int64_t               x = 0, y = 0;
+    std::vector<std::uint64_t> bits;
+    std::size_t                size = 0; // generations recorded
+
+    bool operator[](const std::size_t g) const noexcept
+    {
+        return (bits[g / 64] >> (g % 64)) & 1u;
+    }
+    void push_back(const bool is_head)
+    {
+        if(size % 64 == 0)
+        {
+            bits.push_back(0);
+        }
+        bits.back() |= std::uint64_t(is_head) << (size % 64);
+        this->size += 1;
+        return;
+    }
+
+    // number of heads observed
+    std::size_t count() const noexcept
+    {
+        std::size_t n = 0;
+        for(const auto b : bits)
+        {
+            for(std::uint64_t v = b; v != 0; v &= v - 1) {++n;}
+        }
+        return n;
+    }
+
+    // '0' and '1', one for each generation
+    std::string to_string() const
+    {
+        std::string retval(size, '0');
+        for(std::size_t g=0; g<size; ++g)
+        {
+            if((*this)[g]) {retval[g] = '1';}
+        }
+        return retval;
+    }
+};
+
+// Drives the inputs and records the probes of the ports of a world while the
+// chunk engine updates it. In each generation, inputs are injected first and
+// then the probes are sampled, so a trace also shows the injected heads. An
+// input turns a wire into a head; a head or a tail is left as is. The world
+// must not be expanded while it is used.
+struct testbench
+{
+    explicit testbench(const world& w)
+    {
+        for(const auto& p : w.ports())
+        {
+            if(w(static_cast<std::int32_t>(p.x), static_cast<std::int32_t>(p.y)) == state::vacuum)
+            {
+                throw std::invalid_argument("haywire::testbench: port " + p.name +
+                        " is not on a conductor");
+            }
+            if(p.kind == port::kind_type::input)
+            {
+                inputs_.push_back(p);
+            }
+            else
+            {
+                probe_trace t;
+                t.name = p.name;
+                t.x    = p.x;
+                t.y    = p.y;
+                traces_.push_back(std::move(t));
+            }
+        }
+    }
+
+    // drives and samples the current generation and advances the world.
+    void step(world& w)
+    {
+        for(const auto& p : inputs_)
+        {
+            if(p.injects(generation_))
+            {
+                const auto x = static_cast<std::int32_t>(p.x);
+                const auto y = static_cast<std::int32_t>(p.y);
+                if(std::as_const(w)(x, y) == state::wire)
+                {
+                    w(x, y) = state::head;
+                }
+            }
+        }
+        for(auto& t : traces_)
+        {
+            t.push_back(std::as_const(w)(static_cast<std::int32_t>(t.x),
+                                         static_cast<std::int32_t>(t.y)) == state::head);
+        }
+        w.update();
+        this->generation_ += 1;
+        return;
+    }
+
+    void run(world& w, const std::size_t n)
+    {
+        for(std::size_t i=0; i<n; ++i)
+        {
+            this->step(w);
+        }
+        return;
+    }
+
+    // generations since the construction
+    std::uint64_t generation() const noexcept {return generation_;}
+
+    const std::vector<probe_trace>& traces() const noexcept {return traces_;}
+
+    // a line for each probe: name, x, y, number of heads and the trace.
+    void write(std::ostream& os) const
+    {
+        for(const auto& t : traces_)
+        {
+            os << t.name << ' ' << t.x << ' ' << t.y << ' ' << t.count() << ' '
+               << t.to_string() << '\n';
+        }
+        return;
+    }
+
+  private:
+    std::uint64_t            generation_ = 0;
+    std::vector<port>        inputs_;
+    std::vector<probe_trace> traces_;
+};
+
+} // haywire
+#endif// HAYWIRE_TESTBENCH_HPP
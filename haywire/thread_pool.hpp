@@ -0,0 +1,198 @@
+#ifndef HAYWIRE_THREAD_POOL_HPP
+#define HAYWIRE_THREAD_POOL_HPP
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace haywire
+{
+
+// A persistent pool of threads. parallel_for splits a range into blocks and
+// gives each thread a contiguous part of it. A thread that finishes its own
+// part steals blocks from the back of the others.
+struct thread_pool
+{
+    using range_type = std::pair<std::size_t, std::size_t>;
+
+    // the calling thread also works, so n-1 threads are launched.
+    explicit thread_pool(const std::size_t n)
+        : stop_(false), generation_(0), remaining_(0), job_(nullptr)
+    {
+        const std::size_t num = std::max<std::size_t>(n, 1);
+        for(std::size_t i=0; i<num; ++i)
+        {
+            queues_.push_back(std::make_unique<queue_type>());
+        }
+        for(std::size_t i=1; i<num; ++i)
+        {
+            workers_.emplace_back([this, i]{this->work(i);});
+        }
+    }
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for(auto& th : workers_)
+        {
+            th.join();
+        }
+    }
+    thread_pool(const thread_pool&) = delete;
+    thread_pool(thread_pool&&)      = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    thread_pool& operator=(thread_pool&&)      = delete;
+
+    std::size_t size() const noexcept {return queues_.size();}
+
+    // calls f(begin, end) for blocks of [0, n) that have at most `grain`
+    // elements, and returns after all the blocks are done.
+    template<typename F>
+    void parallel_for(const std::size_t n, const std::size_t grain, F&& f)
+    {
+        if(n == 0) {return;}
+
+        std::lock_guard<std::mutex> call_lock(call_mtx_);
+
+        const std::size_t block   = std::max<std::size_t>(grain, 1);
+        const std::size_t nblocks = (n + block - 1) / block;
+        const std::size_t nthread = this->size();
+
+        // job_ must be visible before a task is pushed. Otherwise a thread
+        // still looking for tasks of the previous call may pick it up.
+        std::function<void(std::size_t, std::size_t)> job(std::forward<F>(f));
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            job_       = &job;
+            error_     = nullptr;
+            remaining_ = nblocks;
+        }
+
+        // blocks next to each other go to the same thread for locality
+        for(std::size_t t=0; t<nthread; ++t)
+        {
+            auto& q = *queues_[t];
+            std::lock_guard<std::mutex> lock(q.mtx);
+            for(std::size_t b = nblocks * t / nthread;
+                            b < nblocks * (t+1) / nthread; ++b)
+            {
+                q.tasks.emplace_back(b * block, std::min(n, (b+1) * block));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            generation_ += 1;
+        }
+        wake_.notify_all();
+
+        this->run_tasks(0);
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            done_.wait(lock, [this]{return remaining_ == 0;});
+            job_ = nullptr;
+        }
+        if(error_)
+        {
+            std::rethrow_exception(error_);
+        }
+        return;
+    }
+
+  private:
+
+    struct queue_type
+    {
+        std::mutex              mtx;
+        std::deque<range_type>  tasks;
+    };
+
+    void work(const std::size_t id)
+    {
+        std::uint64_t seen = 0;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                wake_.wait(lock, [&]{return stop_ || generation_ != seen;});
+                if(stop_) {return;}
+                seen = generation_;
+            }
+            this->run_tasks(id);
+        }
+    }
+
+    void run_tasks(const std::size_t id)
+    {
+        range_type task;
+        while(this->pop(id, task) || this->steal(id, task))
+        {
+            try
+            {
+                (*job_)(task.first, task.second);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if(not error_) {error_ = std::current_exception();}
+            }
+            std::lock_guard<std::mutex> lock(mtx_);
+            remaining_ -= 1;
+            if(remaining_ == 0)
+            {
+                done_.notify_all();
+            }
+        }
+        return;
+    }
+
+    bool pop(const std::size_t id, range_type& task)
+    {
+        auto& q = *queues_[id];
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if(q.tasks.empty()) {return false;}
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+    }
+    bool steal(const std::size_t id, range_type& task)
+    {
+        for(std::size_t i=1; i<queues_.size(); ++i)
+        {
+            auto& q = *queues_[(id + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mtx);
+            if(q.tasks.empty()) {continue;}
+            task = q.tasks.back();
+            q.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+  private:
+
+    bool                    stop_;
+    std::uint64_t           generation_;
+    std::size_t             remaining_;
+    std::function<void(std::size_t, std::size_t)> const* job_;
+    std::exception_ptr      error_;
+
+    std::mutex              call_mtx_; // serializes parallel_for calls
+    std::mutex              mtx_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::vector<std::unique_ptr<queue_type>> queues_;
+    std::vector<std::thread> workers_;
+};
+
+} // haywire
+#endif// HAYWIRE_THREAD_POOL_HPP
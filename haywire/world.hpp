@@ -6,10 +6,20 @@
 #include <extlib/wad/wad/vector.hpp>
 #include <extlib/wad/wad/array.hpp>
 #include <extlib/wad/wad/enum.hpp>
+#include "thread_pool.hpp"
+#include "allocator.hpp"
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <vector>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <cassert>
 
 namespace haywire
@@ -23,19 +33,140 @@ enum state : std::uint8_t
     tail   = 3u,
 };
 
-struct chunk
+// a rectangle of cells in row-major order, e.g. a clipboard.
+struct pattern
 {
-    static constexpr inline std::size_t width  = 8;
-    static constexpr inline std::size_t height = 8;
+    pattern(): width_(0), height_(0) {}
+    pattern(const std::size_t w, const std::size_t h, const state s = state::vacuum)
+        : width_(w), height_(h), cells_(w * h, s)
+    {}
+
+    std::size_t width()  const noexcept {return width_;}
+    std::size_t height() const noexcept {return height_;}
+    bool        empty()  const noexcept {return cells_.empty();}
+
+    state& operator()(const std::size_t x, const std::size_t y)       noexcept
+    {
+        return cells_[width_ * y + x];
+    }
+    state  operator()(const std::size_t x, const std::size_t y) const noexcept
+    {
+        return cells_[width_ * y + x];
+    }
+    state*       row(const std::size_t y)       noexcept {return cells_.data() + width_ * y;}
+    state const* row(const std::size_t y) const noexcept {return cells_.data() + width_ * y;}
+
+    pattern rotated_clockwise() const
+    {
+        pattern retval(height_, width_);
+        for(std::size_t y=0; y<height_; ++y)
+        {
+            for(std::size_t x=0; x<width_; ++x)
+            {
+                retval(height_ - 1 - y, x) = (*this)(x, y);
+            }
+        }
+        return retval;
+    }
+    pattern rotated_counterclockwise() const
+    {
+        pattern retval(height_, width_);
+        for(std::size_t y=0; y<height_; ++y)
+        {
+            for(std::size_t x=0; x<width_; ++x)
+            {
+                retval(y, width_ - 1 - x) = (*this)(x, y);
+            }
+        }
+        return retval;
+    }
+    // swaps left and right
+    pattern mirrored_horizontally() const
+    {
+        pattern retval(*this);
+        for(std::size_t y=0; y<height_; ++y)
+        {
+            std::reverse(retval.row(y), retval.row(y) + width_);
+        }
+        return retval;
+    }
+    // swaps top and bottom
+    pattern mirrored_vertically() const
+    {
+        pattern retval(width_, height_);
+        for(std::size_t y=0; y<height_; ++y)
+        {
+            std::copy_n(this->row(y), width_, retval.row(height_ - 1 - y));
+        }
+        return retval;
+    }
+
+  private:
+    std::size_t        width_, height_;
+    std::vector<state> cells_;
+};
+
+// a named cell of a circuit to drive or watch, e.g. in a testbench. An input
+// has a schedule of '0' and '1', and a head is injected at generation g if the
+// g-th character is '1'. If `repeat` is true, the schedule is repeated. A probe
+// records the cell in each generation.
+struct port
+{
+    enum class kind_type: std::uint8_t {input = 0, probe = 1};
+
+    std::string  name;
+    kind_type    kind   = kind_type::probe;
+    std::int64_t x      = 0; // in the world, moved when the world expands
+    std::int64_t y      = 0;
+    std::string  schedule;   // inputs only
+    bool         repeat = false;
+
+    bool injects(const std::uint64_t generation) const noexcept
+    {
+        if(kind != kind_type::input || schedule.empty())
+        {
+            return false;
+        }
+        if(generation < schedule.size())
+        {
+            return schedule[generation] == '1';
+        }
+        return repeat && schedule[generation % schedule.size()] == '1';
+    }
+};
+
+// states found in a region of a world, a bit for each state (1 << state).
+// Vacuum is not recorded, so an empty region is 0.
+using state_mask = std::uint8_t;
+
+// statistics of a world. Cells are counted as of the last update().
+struct world_statistics
+{
+    std::size_t generation        = 0;
+    std::size_t num_heads         = 0;
+    std::size_t num_tails         = 0;
+    std::size_t num_wires         = 0;
+    std::size_t num_active_chunks = 0;
+    std::size_t width             = 0;
+    std::size_t height            = 0;
+    std::size_t memory            = 0;   // bytes held by chunks, including margins
+    double      update_seconds    = 0.0; // wall time of the last update()
+};
+
+template<std::size_t W, std::size_t H>
+struct basic_chunk
+{
+    static constexpr inline std::size_t width  = W;
+    static constexpr inline std::size_t height = H;
 
     std::array<state, width * height> cells;
 
-    chunk() noexcept {cells.fill(state::vacuum);}
-    ~chunk() noexcept = default;
-    chunk(const chunk&) noexcept = default;
-    chunk(chunk&&)      noexcept = default;
-    chunk& operator=(const chunk&) noexcept = default;
-    chunk& operator=(chunk&&)      noexcept = default;
+    basic_chunk() noexcept {cells.fill(state::vacuum);}
+    ~basic_chunk() noexcept = default;
+    basic_chunk(const basic_chunk&) noexcept = default;
+    basic_chunk(basic_chunk&&)      noexcept = default;
+    basic_chunk& operator=(const basic_chunk&) noexcept = default;
+    basic_chunk& operator=(basic_chunk&&)      noexcept = default;
 
     template<typename Archiver>
     bool save(Archiver& arc) const
@@ -77,67 +208,166 @@ struct chunk
     }
 };
 
-struct world
+using chunk = basic_chunk<8, 8>;
+
+// Layouts of the chunk storage of a world. A layout maps the position of a
+// chunk in the storage, including margins, to its index and back. The width
+// and the height of the storage are multiples of `tile`.
+struct row_major_layout
+{
+    static constexpr inline std::size_t tile = 1;
+
+    static std::size_t index(const std::size_t x, const std::size_t y,
+                             const std::size_t stride) noexcept
+    {
+        return stride * y + x;
+    }
+    static std::pair<std::size_t, std::size_t>
+    position(const std::size_t idx, const std::size_t stride) noexcept
+    {
+        return std::make_pair(idx % stride, idx / stride);
+    }
+};
+
+// T x T chunks are stored together in row-major order, and the tiles are
+// ordered row by row. The chunks above and below a chunk are usually in the
+// same tile, so the neighbors read by update() are close in memory however
+// wide the world is.
+template<std::size_t T>
+struct tiled_layout
 {
+    static_assert(T != 0 && (T & (T - 1)) == 0, "the size of a tile must be a power of 2");
+    static constexpr inline std::size_t tile = T;
+
+    static std::size_t index(const std::size_t x, const std::size_t y,
+                             const std::size_t stride) noexcept
+    {
+        return ((y / T) * (stride / T) + x / T) * (T * T) + (y % T) * T + x % T;
+    }
+    static std::pair<std::size_t, std::size_t>
+    position(const std::size_t idx, const std::size_t stride) noexcept
+    {
+        const std::size_t t = idx / (T * T);
+        const std::size_t r = idx % (T * T);
+        return std::make_pair((t % (stride / T)) * T + r % T, (t / (stride / T)) * T + r / T);
+    }
+};
+
+template<std::size_t W, std::size_t H, typename Layout = row_major_layout>
+struct basic_world
+{
+    using chunk_type   = basic_chunk<W, H>;
+    using layout_type  = Layout;
+    using storage_type = std::vector<chunk_type, chunk_allocator<chunk_type>>;
+
     enum class direction: std::uint8_t {plus, minus};
 
-    world(std::size_t w, std::size_t h)
-        : width_ ((w / chunk::width  + (w % chunk::width  != 0)) * chunk::width),
-          height_((h / chunk::height + (h % chunk::height != 0)) * chunk::height),
-          width_chunk_ (w / chunk::width  + (w % chunk::width  != 0)),
-          height_chunk_(h / chunk::height + (h % chunk::height != 0)),
-          chunks_    (width_chunk_ * height_chunk_),
-          chunks_buf_(width_chunk_ * height_chunk_)
+    basic_world(std::size_t w, std::size_t h)
+        : width_ ((w / chunk_type::width  + (w % chunk_type::width  != 0)) * chunk_type::width),
+          height_((h / chunk_type::height + (h % chunk_type::height != 0)) * chunk_type::height),
+          width_chunk_ (w / chunk_type::width  + (w % chunk_type::width  != 0)),
+          height_chunk_(h / chunk_type::height + (h % chunk_type::height != 0)),
+          stride_(round_up_to_tile(width_chunk_)), capacity_height_(round_up_to_tile(height_chunk_)),
+          offset_x_(0), offset_y_(0), origin_x_(0), origin_y_(0),
+          chunks_    (stride_ * capacity_height_),
+          chunks_buf_(stride_ * capacity_height_),
+          flags_     (stride_ * capacity_height_, 0u)
     {
-        assert(width_chunk_  * chunk::width  == width_);
-        assert(height_chunk_ * chunk::height == height_);
+        assert(width_chunk_  * chunk_type::width  == width_);
+        assert(height_chunk_ * chunk_type::height == height_);
+        this->rebuild_overview();
     }
 
-    world(const toml::value& v)
+    basic_world(const toml::value& v)
         : width_ (toml::find<std::size_t>(v, "width")),
           height_(toml::find<std::size_t>(v, "height")),
-          width_chunk_ (width_  / chunk::width  + (width_  % chunk::width  != 0)),
-          height_chunk_(height_ / chunk::height + (height_ % chunk::height != 0)),
-          chunks_    (toml::find<std::vector<chunk>>(v, "chunks")),
-          chunks_buf_(chunks_)
+          width_chunk_ (width_  / chunk_type::width  + (width_  % chunk_type::width  != 0)),
+          height_chunk_(height_ / chunk_type::height + (height_ % chunk_type::height != 0)),
+          stride_(width_chunk_), capacity_height_(height_chunk_),
+          offset_x_(0), offset_y_(0), origin_x_(0), origin_y_(0)
     {
-        assert(chunks_.size() == width_chunk_ * height_chunk_);
-        assert(width_chunk_  * chunk::width  == width_);
-        assert(height_chunk_ * chunk::height == height_);
+        this->lay_out(toml::find<std::vector<chunk_type>>(v, "chunks"));
+        assert(width_chunk_  * chunk_type::width  == width_);
+        assert(height_chunk_ * chunk_type::height == height_);
+        this->reset_activity();
+
+        if(v.contains("ports"))
+        {
+            for(const auto& p : toml::find<toml::array>(v, "ports"))
+            {
+                port pt;
+                pt.name = toml::find<std::string>(p, "name");
+                const auto kind = toml::find<std::string>(p, "kind");
+                if     (kind == "input") {pt.kind = port::kind_type::input;}
+                else if(kind == "probe") {pt.kind = port::kind_type::probe;}
+                else
+                {
+                    throw std::runtime_error("haywire::world: unknown kind of port: " + kind);
+                }
+                pt.x        = toml::find<std::int64_t>(p, "x");
+                pt.y        = toml::find<std::int64_t>(p, "y");
+                pt.schedule = toml::find_or<std::string>(p, "schedule", "");
+                pt.repeat   = toml::find_or<bool>(p, "repeat", false);
+                this->add_port(std::move(pt));
+            }
+        }
     }
 
     toml::value into_toml() const
     {
-        toml::array tmp(chunks_.size());
-        std::transform(chunks_.begin(), chunks_.end(), tmp.begin(),
+        const auto chunks = this->packed_chunks();
+        toml::array tmp(chunks.size());
+        std::transform(chunks.begin(), chunks.end(), tmp.begin(),
             [](const auto& ch) -> toml::value {return ch.into_toml();});
-        return toml::value{
+        toml::value retval{
             {"width", width_}, {"height", height_}, {"chunks", std::move(tmp)}
         };
+        if(not ports_.empty())
+        {
+            toml::array ports;
+            for(const auto& p : ports_)
+            {
+                toml::value v{{"name", p.name}, {"x", p.x}, {"y", p.y},
+                    {"kind", p.kind == port::kind_type::input ? "input" : "probe"}};
+                if(p.kind == port::kind_type::input)
+                {
+                    v.as_table()["schedule"] = p.schedule;
+                    v.as_table()["repeat"]   = p.repeat;
+                }
+                ports.push_back(std::move(v));
+            }
+            retval.as_table()["ports"] = std::move(ports);
+        }
+        return retval;
     }
 
     template<typename Archiver>
     bool save(Archiver& arc) const
     {
          return wad::save<wad::type::map>(arc,
-                "width", width_, "height", height_, "chunks", chunks_);
+                "width", width_, "height", height_, "chunks", this->packed_chunks());
     }
     template<typename Archiver>
     bool load(Archiver& arc)
     {
+        std::vector<chunk_type> chunks;
         const auto result = wad::load<wad::type::map>(arc,
-                "width", width_, "height", height_, "chunks", chunks_);
+                "width", width_, "height", height_, "chunks", chunks);
 
-        width_chunk_  = width_  / chunk::width  + (width_  % chunk::width  != 0),
-        height_chunk_ = height_ / chunk::height + (height_ % chunk::height != 0),
-        chunks_buf_   = chunks_;
+        width_chunk_  = width_  / chunk_type::width  + (width_  % chunk_type::width  != 0),
+        height_chunk_ = height_ / chunk_type::height + (height_ % chunk_type::height != 0),
+        origin_x_ = 0; origin_y_ = 0;
+        this->lay_out(std::move(chunks));
+        generation_   = 0;
+        ports_.clear();
+        this->reset_activity();
         return result;
     }
 
     state& operator()(const std::int32_t x, const std::int32_t y) noexcept
     {
-        constexpr std::size_t chunk_width  = chunk::width;
-        constexpr std::size_t chunk_height = chunk::height;
+        constexpr std::size_t chunk_width  = chunk_type::width;
+        constexpr std::size_t chunk_height = chunk_type::height;
 
         assert(0 <= x && x < width_ && 0 <= y && y < height_);
 
@@ -146,12 +376,13 @@ struct world
         const auto y_chk = y / chunk_height;
         const auto y_rem = y % chunk_height;
 
-        return chunks_[width_chunk_ * y_chk + x_chk](x_rem, y_rem);
+        this->activate(this->index(x_chk, y_chk));
+        return chunks_[this->index(x_chk, y_chk)](x_rem, y_rem);
     }
     state operator()(const std::int32_t x, const std::int32_t y) const noexcept
     {
-        constexpr std::size_t chunk_width  = chunk::width;
-        constexpr std::size_t chunk_height = chunk::height;
+        constexpr std::size_t chunk_width  = chunk_type::width;
+        constexpr std::size_t chunk_height = chunk_type::height;
 
         if(x < 0 || width_ <= x || y < 0 || height_ <= y)
         {
@@ -163,176 +394,1306 @@ struct world
         const auto y_chk = y / chunk_height;
         const auto y_rem = y % chunk_height;
 
-        return chunks_[width_chunk_ * y_chk + x_chk](x_rem, y_rem);
+        return chunks_[this->index(x_chk, y_chk)](x_rem, y_rem);
     }
 
-    chunk& chunk_at(const std::uint32_t x, const std::uint32_t y,
+    chunk_type& chunk_at(const std::uint32_t x, const std::uint32_t y,
                     const std::nothrow_t&) noexcept
     {
-        return chunks_[width_chunk_ * y + x];
+        this->activate(this->index(x, y));
+        return chunks_[this->index(x, y)];
     }
-    chunk const& chunk_at(const std::uint32_t x, const std::uint32_t y,
+    chunk_type const& chunk_at(const std::uint32_t x, const std::uint32_t y,
                           const std::nothrow_t&) const noexcept
     {
-        return chunks_[width_chunk_ * y + x];
+        return chunks_[this->index(x, y)];
     }
 
-    chunk& chunk_at(const std::uint32_t x, const std::uint32_t y)
+    chunk_type& chunk_at(const std::uint32_t x, const std::uint32_t y)
     {
-        return chunks_.at(width_chunk_ * y + x);
+        this->check_chunk_range(x, y);
+        this->activate(this->index(x, y));
+        return chunks_[this->index(x, y)];
     }
-    chunk const& chunk_at(const std::uint32_t x, const std::uint32_t y) const
+    chunk_type const& chunk_at(const std::uint32_t x, const std::uint32_t y) const
     {
-        return chunks_.at(width_chunk_ * y + x);
+        this->check_chunk_range(x, y);
+        return chunks_[this->index(x, y)];
     }
 
     void update()
     {
-        constexpr std::size_t chunk_width  = chunk::width;
-        constexpr std::size_t chunk_height = chunk::height;
+        const auto start = std::chrono::steady_clock::now();
 
         chunks_buf_.resize(chunks_.size());
+        flags_.resize(chunks_.size(), 0u);
+        hashes_.resize(chunks_.size(), 0u);
+        summaries_.resize(chunks_.size(), 0u);
 
-        for(std::uint32_t y = 0; y < this->height_; ++y)
+        // chunks that contain head or tail and their neighbors may change.
+        // others are made of only wire and vacuum and remain the same.
+        targets_buf_.clear();
+        for(const std::size_t idx : active_)
         {
-            const auto y_chk = y / chunk_height;
-            const auto y_rem = y % chunk_height;
-
-            for(std::uint32_t x = 0; x < this->width_; ++x)
+            const auto [x_chk, y_chk] = this->position_of(idx);
+            for(std::size_t y = std::max<std::size_t>(y_chk, 1) - 1;
+                y <= std::min(y_chk + 1, height_chunk_ - 1); ++y)
             {
-                const auto x_chk = x / chunk_width;
-                const auto x_rem = x % chunk_width;
-
-                const auto& self = *this;// as_const
-                switch(self(x, y))
+                for(std::size_t x = std::max<std::size_t>(x_chk, 1) - 1;
+                    x <= std::min(x_chk + 1, width_chunk_ - 1); ++x)
                 {
-                    case state::vacuum:
-                    {
-                        chunks_buf_[width_chunk_ * y_chk + x_chk]
-                            (x_rem, y_rem) = state::vacuum;
-                        break;
-                    }
-                    case state::wire:
+                    const std::size_t target = this->index(x, y);
+                    if((flags_[target] & flag_target) == 0)
                     {
-                        const int count =
-                            static_cast<int>(self(x-1, y-1) == state::head) +
-                            static_cast<int>(self(x  , y-1) == state::head) +
-                            static_cast<int>(self(x+1, y-1) == state::head) +
-                            static_cast<int>(self(x-1, y  ) == state::head) +
-                            static_cast<int>(self(x  , y  ) == state::head) +
-                            static_cast<int>(self(x+1, y  ) == state::head) +
-                            static_cast<int>(self(x-1, y+1) == state::head) +
-                            static_cast<int>(self(x  , y+1) == state::head) +
-                            static_cast<int>(self(x+1, y+1) == state::head);
-                        if(count == 1 || count == 2)
-                        {
-                            chunks_buf_[width_chunk_ * y_chk + x_chk]
-                                (x_rem, y_rem) = state::head;
-                        }
-                        else
-                        {
-                            chunks_buf_[width_chunk_ * y_chk + x_chk]
-                                (x_rem, y_rem) = state::wire;
-                        }
-                        break;
+                        flags_[target] |= flag_target;
+                        targets_buf_.push_back(target);
                     }
-                    case state::head:
-                    {
-                        chunks_buf_[width_chunk_ * y_chk + x_chk]
-                            (x_rem, y_rem) = state::tail;
-                        break;
-                    }
-                    case state::tail:
+                }
+            }
+            flags_[idx] &= ~flag_active;
+        }
+
+        // the buffer of chunks that were updated in the previous step holds
+        // an older state. If they are not updated in this step, restore it.
+        for(const std::size_t idx : targets_)
+        {
+            if((flags_[idx] & flag_target) == 0)
+            {
+                chunks_buf_[idx] = chunks_[idx];
+            }
+        }
+
+        // conductors do not change in update(). Only the edited chunks are
+        // re-counted and re-hashed. Heads and tails are counted below.
+        this->apply_edits();
+
+        // update chunks in the order of memory
+        std::sort(targets_buf_.begin(), targets_buf_.end());
+
+        // all the heads and tails are in the targets.
+        std::atomic<std::size_t>   num_heads{0}, num_tails{0};
+        std::atomic<std::uint64_t> hash_diff{0};
+        const auto update_targets = [this, &num_heads, &num_tails, &hash_diff](
+                const std::size_t first, const std::size_t last) {
+            // each chunk is written by only one thread.
+            std::size_t   heads = 0, tails = 0;
+            std::uint64_t diff  = 0;
+            for(std::size_t i=first; i<last; ++i)
+            {
+                const std::size_t idx = targets_buf_[i];
+                flags_[idx] &= ~flag_target;
+                const auto [x_chk, y_chk] = this->position_of(idx);
+                const auto [h, t] = this->update_chunk(x_chk, y_chk);
+                if(h + t != 0)
+                {
+                    flags_[idx] |= flag_active;
+                }
+                if(chunks_buf_[idx].cells != chunks_[idx].cells)
+                {
+                    flags_[idx] |= flag_changed;
+
+                    const auto hash = this->hash_of(idx, chunks_buf_[idx]);
+                    diff += hash - hashes_[idx];
+                    hashes_[idx] = hash;
+
+                    const auto mask = mask_of(chunks_buf_[idx]);
+                    if(mask != summaries_[idx])
                     {
-                        chunks_buf_[width_chunk_ * y_chk + x_chk]
-                            (x_rem, y_rem) = state::wire;
-                        break;
+                        summaries_[idx] = mask;
+                        flags_[idx] |= flag_summary;
                     }
                 }
+                heads += h;
+                tails += t;
+            }
+            num_heads.fetch_add(heads, std::memory_order_relaxed);
+            num_tails.fetch_add(tails, std::memory_order_relaxed);
+            hash_diff.fetch_add(diff,  std::memory_order_relaxed);
+        };
+        if(pool_ && pool_->size() > 1 && targets_buf_.size() > parallel_grain)
+        {
+            pool_->parallel_for(targets_buf_.size(), parallel_grain,
+                                update_targets);
+        }
+        else
+        {
+            update_targets(0, targets_buf_.size());
+        }
+
+        active_.clear();
+        changed_.clear();
+        for(const std::size_t idx : targets_buf_)
+        {
+            if((flags_[idx] & flag_active) != 0)
+            {
+                active_.push_back(idx);
+            }
+            if((flags_[idx] & flag_changed) != 0)
+            {
+                flags_[idx] &= ~flag_changed;
+                changed_.push_back(idx);
+                this->mark_dirty(idx);
+            }
+            if((flags_[idx] & flag_summary) != 0)
+            {
+                flags_[idx] &= ~flag_summary;
+                overview_queue_.push_back(Layout::position(idx, stride_));
             }
         }
+        this->propagate_overview();
+        std::swap(targets_buf_, targets_);
         std::swap(chunks_buf_, chunks_);
+
+        this->num_heads_ = num_heads.load(std::memory_order_relaxed);
+        this->num_tails_ = num_tails.load(std::memory_order_relaxed);
+        this->hash_     += hash_diff.load(std::memory_order_relaxed);
+        this->generation_ += 1;
+        this->update_seconds_ = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
         return;
     }
 
     void expand_width(direction dir)
     {
-        chunks_buf_.resize(chunks_.size() + this->height_chunk_);
-        std::fill(chunks_buf_.begin(), chunks_buf_.end(), chunk{});
+        if(dir == direction::plus) {this->expand(0, 1, 0, 0);}
+        else                       {this->expand(1, 0, 0, 0);}
+        return;
+    }
+    void expand_height(direction dir)
+    {
+        if(dir == direction::plus) {this->expand(0, 0, 0, 1);}
+        else                       {this->expand(0, 0, 1, 0);}
+        return;
+    }
+
+    // adds chunks to each side. Margins are reserved in all directions, so
+    // that it usually just moves the offset. When the margin runs out, the
+    // storage is re-allocated with margins proportional to the size and the
+    // chunks are moved once. Chunk (0, 0) moves to (left, top).
+    void expand(const std::size_t left,   const std::size_t right,
+                const std::size_t top,    const std::size_t bottom)
+    {
+        if(offset_x_ < left || offset_y_ < top ||
+           stride_          < offset_x_ + width_chunk_  + right ||
+           capacity_height_ < offset_y_ + height_chunk_ + bottom)
+        {
+            this->reallocate(left, right, top, bottom);
+        }
+        this->offset_x_ -= left;
+        this->offset_y_ -= top;
+        this->width_chunk_  += left + right;
+        this->height_chunk_ += top  + bottom;
+        this->width_  = chunk_type::width  * width_chunk_;
+        this->height_ = chunk_type::height * height_chunk_;
+        this->origin_x_ += chunk_type::width  * left;
+        this->origin_y_ += chunk_type::height * top;
+        for(auto& p : ports_)
+        {
+            p.x += chunk_type::width  * left;
+            p.y += chunk_type::height * top;
+        }
+        // the overview is aligned to the storage, and the new chunks were
+        // vacuum in the margin. It is kept as is.
+        return;
+    }
+
+    // expands the world so that cells in [x0, x1) x [y0, y1) are inside it.
+    // coordinates can be negative. Returns false if it is already inside.
+    bool expand_to_cover(const std::int64_t x0, const std::int64_t y0,
+                         const std::int64_t x1, const std::int64_t y1)
+    {
+        constexpr std::int64_t w = chunk_type::width;
+        constexpr std::int64_t h = chunk_type::height;
+        const std::int64_t width  = width_;
+        const std::int64_t height = height_;
+
+        const std::size_t left   = (x0 < 0)      ? (w - 1 - x0) / w          : 0;
+        const std::size_t right  = (width  < x1) ? (x1 - width  + w - 1) / w : 0;
+        const std::size_t top    = (y0 < 0)      ? (h - 1 - y0) / h          : 0;
+        const std::size_t bottom = (height < y1) ? (y1 - height + h - 1) / h : 0;
+        if(left == 0 && right == 0 && top == 0 && bottom == 0)
+        {
+            return false;
+        }
+        this->expand(left, right, top, bottom);
+        return true;
+    }
+
+    // copies cells in [x0, x1) x [y0, y1). Cells outside of the world are
+    // vacuum. Each row of a chunk is copied at once.
+    pattern copy(const std::int64_t x0, const std::int64_t y0,
+                 const std::int64_t x1, const std::int64_t y1) const
+    {
+        pattern retval(static_cast<std::size_t>(std::max<std::int64_t>(x1 - x0, 0)),
+                       static_cast<std::size_t>(std::max<std::int64_t>(y1 - y0, 0)));
+        this->for_each_span(std::max<std::int64_t>(x0, 0), std::max<std::int64_t>(y0, 0),
+            std::min<std::int64_t>(x1, width_), std::min<std::int64_t>(y1, height_),
+            [&](const std::size_t x_chk, const std::size_t y_chk, const std::size_t x,
+                const std::size_t y, const std::size_t len) {
+                const auto& ch = chunks_[this->index(x_chk, y_chk)];
+                std::copy_n(ch.cells.begin() + W * (y % H) + x % W, len,
+                            retval.row(y - y0) + (x - x0));
+            });
+        return retval;
+    }
+
+    // writes the pattern with its left-top corner at (x, y). The world is
+    // expanded at most once to cover it. (x, y) is in the coordinates before
+    // the expansion.
+    void paste(const pattern& p, std::int64_t x, std::int64_t y)
+    {
+        if(p.empty())
+        {
+            return;
+        }
+        const auto origin_x = origin_x_;
+        const auto origin_y = origin_y_;
+        this->expand_to_cover(x, y, x + p.width(), y + p.height());
+        x += origin_x_ - origin_x;
+        y += origin_y_ - origin_y;
+
+        this->for_each_span(x, y, x + p.width(), y + p.height(),
+            [&](const std::size_t x_chk, const std::size_t y_chk, const std::size_t x_c,
+                const std::size_t y_c, const std::size_t len) {
+                auto& ch = this->chunk_at(x_chk, y_chk, std::nothrow);
+                std::copy_n(p.row(y_c - y) + (x_c - x), len,
+                            ch.cells.begin() + W * (y_c % H) + x_c % W);
+            });
+        return;
+    }
+
+    // sets cells in [x0, x1) x [y0, y1) to s. The world is expanded at most
+    // once to cover them. Coordinates are the ones before the expansion.
+    void fill(std::int64_t x0, std::int64_t y0, std::int64_t x1, std::int64_t y1,
+              const state s)
+    {
+        if(x1 <= x0 || y1 <= y0)
+        {
+            return;
+        }
+        const auto origin_x = origin_x_;
+        const auto origin_y = origin_y_;
+        this->expand_to_cover(x0, y0, x1, y1);
+        x0 += origin_x_ - origin_x; x1 += origin_x_ - origin_x;
+        y0 += origin_y_ - origin_y; y1 += origin_y_ - origin_y;
+        this->fill_inside(x0, y0, x1, y1, s);
+        return;
+    }
+
+    // sets cells in [x0, x1) x [y0, y1) to vacuum. It does not expand the
+    // world.
+    void clear(const std::int64_t x0, const std::int64_t y0,
+               const std::int64_t x1, const std::int64_t y1)
+    {
+        this->fill_inside(std::max<std::int64_t>(x0, 0), std::max<std::int64_t>(y0, 0),
+                          std::min<std::int64_t>(x1, width_), std::min<std::int64_t>(y1, height_),
+                          state::vacuum);
+        return;
+    }
+
+    std::size_t width()  const noexcept {return width_ ;}
+    std::size_t height() const noexcept {return height_;}
+
+    // number of cells added to the minus direction since construction.
+    // A cell (x, y) was at (x - origin_x(), y - origin_y()) at first.
+    std::int64_t origin_x() const noexcept {return origin_x_;}
+    std::int64_t origin_y() const noexcept {return origin_y_;}
+
+    // number of chunks that contain head or tail
+    std::size_t num_active_chunks() const noexcept {return active_.size();}
+
+    // number of update() calls since construction or load
+    std::size_t generation() const noexcept {return generation_;}
+
+    // cells are counted in update(). After the cells are modified from
+    // outside, the counts are updated by the next update(), recount() or
+    // recount_edited().
+    std::size_t num_heads() const noexcept {return num_heads_;}
+    std::size_t num_tails() const noexcept {return num_tails_;}
+    std::size_t num_wires() const noexcept
+    {
+        return num_conductors_ - num_heads_ - num_tails_;
+    }
+
+    // bytes held by the chunks and the buffer, including margins. A copy made
+    // by publish_to() reports the world it is copied from.
+    std::size_t memory_usage() const noexcept
+    {
+        if(published_memory_ != 0)
+        {
+            return published_memory_;
+        }
+        return (chunks_.capacity() + chunks_buf_.capacity()) * sizeof(chunk_type);
+    }
+
+    world_statistics statistics() const noexcept
+    {
+        world_statistics stats;
+        stats.generation        = generation_;
+        stats.num_heads         = this->num_heads();
+        stats.num_tails         = this->num_tails();
+        stats.num_wires         = this->num_wires();
+        stats.num_active_chunks = this->num_active_chunks();
+        stats.width             = width_;
+        stats.height            = height_;
+        stats.memory            = this->memory_usage();
+        stats.update_seconds    = update_seconds_;
+        return stats;
+    }
+
+    // hash of the cells, as of the last update() or recount(). It is the sum
+    // of the hashes of chunks, and a chunk that has only vacuum contributes
+    // 0. Chunks are hashed with their positions in the initial coordinates,
+    // so the hash does not change when the world expands.
+    std::uint64_t hash() const noexcept {return hash_;}
+
+    std::uint64_t chunk_hash(const std::uint32_t x, const std::uint32_t y) const
+    {
+        this->check_chunk_range(x, y);
+        const auto idx = this->index(x, y);
+        return idx < hashes_.size() ? hashes_[idx] : 0;
+    }
 
-        if(dir == direction::plus)
+    // A pyramid of the states in groups of chunks, to draw a world zoomed out
+    // without reading all the cells. overview(level, x, y) is the states in
+    // 2^level x 2^level chunks from chunk (x << level, y << level) of the
+    // storage; level 0 is a chunk. Chunk (x_chk, y_chk) of the world is at
+    // (x_chk + overview_offset_x(), y_chk + overview_offset_y()) of the
+    // storage. Groups are aligned to the storage, not to the world, so that
+    // expand() leaves them as they are unless the storage is re-allocated.
+    // Regions out of the world are 0.
+    //
+    // It is as of the last update() or recount(). update() re-summarizes only
+    // the chunks that changed, and a group only if a chunk in it changed its
+    // mask. update_overview() reflects cells modified from outside.
+    state_mask overview(const std::size_t level, const std::size_t x, const std::size_t y) const noexcept
+    {
+        if(level == 0)
         {
-            for(std::uint32_t y = 0; y < this->height_chunk_; ++y)
+            if(stride_ <= x || capacity_height_ <= y)
             {
-                for(std::uint32_t x = 0; x < this->width_chunk_; ++x)
-                {
-                    chunks_buf_.at((this->width_chunk_ + 1) * y + x) =
-                        chunks_.at( this->width_chunk_      * y + x);
-                }
+                return 0;
+            }
+            const auto idx = Layout::index(x, y, stride_);
+            return idx < summaries_.size() ? summaries_[idx] : 0;
+        }
+        if(overview_.size() < level)
+        {
+            // the top level has only one group
+            return (x == 0 && y == 0) ? this->overview(overview_.size(), 0, 0) : 0;
+        }
+        const std::size_t w = this->overview_width(level);
+        if(w <= x || this->overview_height(level) <= y)
+        {
+            return 0;
+        }
+        return overview_[level - 1][w * y + x];
+    }
+    // levels up to the one that has only one group
+    std::size_t overview_levels() const noexcept {return overview_.size() + 1;}
+    // the position of chunk (0, 0) of the world in the overview, in chunks
+    std::size_t overview_offset_x() const noexcept {return offset_x_;}
+    std::size_t overview_offset_y() const noexcept {return offset_y_;}
+
+    // calls f(x_chk, y_chk) for each chunk that has a cell other than vacuum,
+    // as of the overview. Empty groups of chunks are skipped as a whole, so
+    // it costs as much as the footprint of the world.
+    template<typename F>
+    void for_each_nonempty_chunk(F&& f) const
+    {
+        std::vector<std::array<std::size_t, 3>> stack{{{overview_.size(), 0, 0}}};
+        while(not stack.empty())
+        {
+            const auto [level, x, y] = stack.back();
+            stack.pop_back();
+            if(this->overview(level, x, y) == 0)
+            {
+                continue;
             }
+            if(level == 0)
+            {
+                f(x - offset_x_, y - offset_y_); // margins are vacuum
+                continue;
+            }
+            stack.push_back({{level - 1, 2 * x + 1, 2 * y + 1}});
+            stack.push_back({{level - 1, 2 * x,     2 * y + 1}});
+            stack.push_back({{level - 1, 2 * x + 1, 2 * y    }});
+            stack.push_back({{level - 1, 2 * x,     2 * y    }});
+        }
+        return;
+    }
+
+    void update_overview()
+    {
+        summaries_.resize(chunks_.size(), 0u);
+        for(const std::size_t idx : edited_)
+        {
+            this->summarize(idx, chunks_[idx]);
+        }
+        this->propagate_overview();
+        return;
+    }
+
+    // named inputs and probes. They are saved with the cells in .toml and
+    // .hwb. A port with the same name is replaced.
+    const std::vector<port>& ports() const noexcept {return ports_;}
+
+    void add_port(port p)
+    {
+        if(p.name.empty())
+        {
+            throw std::invalid_argument("haywire::world::add_port: empty name");
+        }
+        if(p.x < 0 || static_cast<std::int64_t>(width_)  <= p.x ||
+           p.y < 0 || static_cast<std::int64_t>(height_) <= p.y)
+        {
+            throw std::out_of_range("haywire::world::add_port: port " + p.name + " (" +
+                std::to_string(p.x) + ", " + std::to_string(p.y) + ") is out of " +
+                std::to_string(width_) + "x" + std::to_string(height_));
+        }
+        if(p.schedule.find_first_not_of("01") != std::string::npos)
+        {
+            throw std::invalid_argument("haywire::world::add_port: schedule of " +
+                p.name + " has a character other than 0 and 1");
+        }
+        const auto found = std::find_if(ports_.begin(), ports_.end(),
+                [&p](const port& q) {return q.name == p.name;});
+        if(found != ports_.end())
+        {
+            *found = std::move(p);
         }
         else
         {
-            for(std::uint32_t y = 0; y < this->height_chunk_; ++y)
+            ports_.push_back(std::move(p));
+        }
+        return;
+    }
+    bool remove_port(const std::string& name)
+    {
+        const auto found = std::find_if(ports_.begin(), ports_.end(),
+                [&name](const port& p) {return p.name == name;});
+        if(found == ports_.end())
+        {
+            return false;
+        }
+        ports_.erase(found);
+        return true;
+    }
+
+    // counts and hashes all the cells from scratch. Margins are vacuum and
+    // are skipped.
+    void recount()
+    {
+        for(const std::size_t idx : edited_)
+        {
+            flags_[idx] &= ~flag_edited;
+        }
+        edited_.clear();
+        this->edited_conductors_ = 0;
+        this->edited_heads_      = 0;
+        this->edited_tails_      = 0;
+        this->num_heads_      = 0;
+        this->num_tails_      = 0;
+        this->num_conductors_ = 0;
+        this->hashes_.assign(chunks_.size(), 0u);
+        this->hash_ = 0;
+        this->summaries_.assign(chunks_.size(), 0u);
+        for(std::size_t y=0; y<height_chunk_; ++y)
+        {
+            for(std::size_t x=0; x<width_chunk_; ++x)
             {
-                for(std::uint32_t x = 0; x < this->width_chunk_; ++x)
+                const auto idx    = this->index(x, y);
+                const auto counts = count_states(chunks_[idx]);
+                this->num_heads_      += counts[state::head];
+                this->num_tails_      += counts[state::tail];
+                this->num_conductors_ += counts[state::wire] + counts[state::head] +
+                                         counts[state::tail];
+                this->hashes_[idx]    = this->hash_of(idx, chunks_[idx]);
+                this->hash_          += hashes_[idx];
+                this->summaries_[idx] = mask_of(chunks_[idx]);
+            }
+        }
+        this->rebuild_overview();
+        return;
+    }
+
+    // re-counts, re-hashes and re-summarizes only the chunks modified since
+    // the last update(), e.g. after another engine stores its state into the
+    // world. The result is the same as recount().
+    void recount_edited()
+    {
+        hashes_   .resize(chunks_.size(), 0u);
+        summaries_.resize(chunks_.size(), 0u);
+        this->apply_edits();
+        this->propagate_overview();
+        return;
+    }
+
+    // chunks changed by update() or possibly modified from outside since the
+    // last clear_dirty(). If is_all_dirty() is true, all the chunks should be
+    // regarded as changed, e.g. after construction or load.
+    bool        is_all_dirty()     const noexcept {return is_all_dirty_;}
+    std::size_t num_dirty_chunks() const noexcept {return dirty_.size();}
+
+    // calls f(x_chk, y_chk) for each dirty chunk
+    template<typename F>
+    void for_each_dirty_chunk(F&& f) const
+    {
+        for(const std::size_t idx : dirty_)
+        {
+            const auto [x_chk, y_chk] = this->position_of(idx);
+            f(x_chk, y_chk);
+        }
+        return;
+    }
+    // calls f(x_chk, y_chk) for each chunk changed by the last update().
+    // Chunks modified from outside after that are not included.
+    template<typename F>
+    void for_each_changed_chunk(F&& f) const
+    {
+        for(const std::size_t idx : changed_)
+        {
+            const auto [x_chk, y_chk] = this->position_of(idx);
+            f(x_chk, y_chk);
+        }
+        return;
+    }
+    // calls f(x_chk, y_chk) for each chunk modified from outside since the
+    // last update() or recount_edited().
+    template<typename F>
+    void for_each_edited_chunk(F&& f) const
+    {
+        for(const std::size_t idx : edited_)
+        {
+            const auto [x_chk, y_chk] = this->position_of(idx);
+            f(x_chk, y_chk);
+        }
+        return;
+    }
+
+    void mark_all_dirty()
+    {
+        this->clear_dirty();
+        this->is_all_dirty_ = true;
+        return;
+    }
+    void clear_dirty()
+    {
+        for(const std::size_t idx : dirty_)
+        {
+            flags_[idx] &= ~flag_dirty;
+        }
+        dirty_.clear();
+        this->is_all_dirty_ = false;
+        return;
+    }
+
+    // copies what a reader of a world needs into `dst`: the cells, the
+    // statistics, the hash of the world, the overview, the dirty chunks and
+    // the ports. The buffers of update() and the hashes of chunks are not
+    // copied, so `dst` can only be read. update_overview() should be called
+    // before it.
+    void publish_to(basic_world& dst) const
+    {
+        dst.width_           = width_;
+        dst.height_          = height_;
+        dst.width_chunk_     = width_chunk_;
+        dst.height_chunk_    = height_chunk_;
+        dst.stride_          = stride_;
+        dst.capacity_height_ = capacity_height_;
+        dst.offset_x_        = offset_x_;
+        dst.offset_y_        = offset_y_;
+        dst.origin_x_        = origin_x_;
+        dst.origin_y_        = origin_y_;
+        dst.chunks_          = chunks_;
+        dst.chunks_buf_      = storage_type{};
+        dst.flags_.clear();
+        dst.targets_.clear();
+        dst.targets_buf_.clear();
+        dst.edited_.clear();
+        dst.hashes_.clear();
+        dst.summaries_       = summaries_;
+        dst.overview_        = overview_;
+        dst.overview_queue_.clear();
+        dst.pool_.reset();
+        this->publish_state_to(dst);
+        return;
+    }
+    // copies only the cells and the overview of the chunks in `chunks`, a
+    // list of (x_chk, y_chk). It must include all the chunks that have been
+    // dirty since `dst` was copied from this world. If the chunks have been
+    // moved since then, e.g. by expand(), all of them are copied.
+    void publish_to(basic_world& dst,
+                    const std::vector<std::pair<std::size_t, std::size_t>>& chunks) const
+    {
+        if(dst.width_chunk_ != width_chunk_ || dst.height_chunk_    != height_chunk_    ||
+           dst.stride_      != stride_      || dst.capacity_height_ != capacity_height_ ||
+           dst.offset_x_    != offset_x_    || dst.offset_y_        != offset_y_        ||
+           dst.summaries_.size() != summaries_.size() || dst.overview_.size() != overview_.size())
+        {
+            this->publish_to(dst);
+            return;
+        }
+        for(const auto& [x, y] : chunks)
+        {
+            if(width_chunk_ <= x || height_chunk_ <= y)
+            {
+                continue;
+            }
+            const auto idx = this->index(x, y);
+            dst.chunks_[idx] = chunks_[idx];
+            if(idx < summaries_.size())
+            {
+                dst.summaries_[idx] = summaries_[idx];
+            }
+            const std::size_t x_s = x + offset_x_;
+            const std::size_t y_s = y + offset_y_;
+            for(std::size_t level=1; level <= overview_.size(); ++level)
+            {
+                const std::size_t i = this->overview_width(level) * (y_s >> level) + (x_s >> level);
+                dst.overview_[level - 1][i] = overview_[level - 1][i];
+            }
+        }
+        this->publish_state_to(dst);
+        return;
+    }
+
+    // copies of a world share the same pool.
+    void set_num_threads(const std::size_t n)
+    {
+        if(n <= 1)
+        {
+            pool_.reset();
+        }
+        else if(not pool_ || pool_->size() != n)
+        {
+            pool_ = std::make_shared<thread_pool>(n);
+        }
+        return;
+    }
+    std::size_t num_threads() const noexcept
+    {
+        return pool_ ? pool_->size() : 1;
+    }
+
+  private:
+
+    // the part of publish_to() that does not depend on the number of chunks
+    void publish_state_to(basic_world& dst) const
+    {
+        dst.active_            = active_;
+        dst.dirty_             = dirty_;
+        dst.changed_           = changed_;
+        dst.is_all_dirty_      = is_all_dirty_;
+        dst.edited_conductors_ = 0;
+        dst.edited_heads_      = 0;
+        dst.edited_tails_      = 0;
+        dst.num_conductors_    = num_conductors_;
+        dst.num_heads_         = num_heads_;
+        dst.num_tails_         = num_tails_;
+        dst.generation_        = generation_;
+        dst.update_seconds_    = update_seconds_;
+        dst.hash_              = hash_;
+        dst.ports_             = ports_;
+        dst.published_memory_  = this->memory_usage();
+        return;
+    }
+
+    // calls f(x_chk, y_chk, x, y, len) for each span of cells in a row of a
+    // chunk, where (x, y) is the first cell. The region must be inside.
+    template<typename F>
+    void for_each_span(const std::int64_t x0, const std::int64_t y0,
+                       const std::int64_t x1, const std::int64_t y1, F&& f) const
+    {
+        for(std::int64_t y=y0; y<y1; ++y)
+        {
+            const std::size_t y_chk = y / H;
+            for(std::int64_t x=x0; x<x1; )
+            {
+                const std::size_t x_chk = x / W;
+                const std::int64_t len = std::min<std::int64_t>(x1 - x, W - x % W);
+                f(x_chk, y_chk, static_cast<std::size_t>(x), static_cast<std::size_t>(y),
+                  static_cast<std::size_t>(len));
+                x += len;
+            }
+        }
+        return;
+    }
+
+    // whole chunks are filled at once. The region must be inside.
+    void fill_inside(const std::int64_t x0, const std::int64_t y0,
+                     const std::int64_t x1, const std::int64_t y1, const state s)
+    {
+        if(x1 <= x0 || y1 <= y0)
+        {
+            return;
+        }
+        for(std::size_t y_chk = y0 / H; static_cast<std::int64_t>(y_chk * H) < y1; ++y_chk)
+        {
+            for(std::size_t x_chk = x0 / W; static_cast<std::int64_t>(x_chk * W) < x1; ++x_chk)
+            {
+                auto& ch = this->chunk_at(x_chk, y_chk, std::nothrow);
+                const std::int64_t left   = std::max<std::int64_t>(x0, x_chk * W);
+                const std::int64_t right  = std::min<std::int64_t>(x1, (x_chk + 1) * W);
+                const std::int64_t top    = std::max<std::int64_t>(y0, y_chk * H);
+                const std::int64_t bottom = std::min<std::int64_t>(y1, (y_chk + 1) * H);
+                if(right - left == static_cast<std::int64_t>(W) &&
+                   bottom - top == static_cast<std::int64_t>(H))
+                {
+                    ch.cells.fill(s);
+                    continue;
+                }
+                for(std::int64_t y=top; y<bottom; ++y)
                 {
-                    // chunks are expanded to the minus direction
-                    chunks_buf_.at((this->width_chunk_ + 1) * y + x + 1) =
-                        chunks_.at( this->width_chunk_      * y + x);
+                    std::fill_n(ch.cells.begin() + W * (y % H) + left % W, right - left, s);
                 }
             }
         }
-        chunks_ = chunks_buf_;
-        this->width_chunk_ += 1;
-        this->width_        = chunk::width * width_chunk_;
-        assert(chunks_.size() == this->width_chunk_ * this->height_chunk_);
         return;
     }
-    void expand_height(direction dir)
+
+    // chunks_ has margins around the world. index of chunk (x, y) is:
+    std::size_t index(const std::size_t x_chk, const std::size_t y_chk) const noexcept
+    {
+        return Layout::index(x_chk + offset_x_, y_chk + offset_y_, stride_);
+    }
+    // the position of a chunk in the world
+    std::pair<std::size_t, std::size_t> position_of(const std::size_t idx) const noexcept
+    {
+        const auto [x, y] = Layout::position(idx, stride_);
+        return std::make_pair(x - offset_x_, y - offset_y_);
+    }
+    static std::size_t round_up_to_tile(const std::size_t n) noexcept
+    {
+        return (n + Layout::tile - 1) / Layout::tile * Layout::tile;
+    }
+
+    // stores chunks in row-major order without margins
+    void lay_out(std::vector<chunk_type> chunks)
+    {
+        assert(chunks.size() == width_chunk_ * height_chunk_);
+        this->stride_          = round_up_to_tile(width_chunk_);
+        this->capacity_height_ = round_up_to_tile(height_chunk_);
+        this->offset_x_        = 0;
+        this->offset_y_        = 0;
+        this->chunks_.assign(stride_ * capacity_height_, chunk_type{});
+        for(std::size_t y=0; y<height_chunk_; ++y)
+        {
+            for(std::size_t x=0; x<width_chunk_; ++x)
+            {
+                this->chunks_[this->index(x, y)] = chunks[width_chunk_ * y + x];
+            }
+        }
+        this->chunks_buf_ = chunks_;
+        return;
+    }
+
+    void check_chunk_range(const std::size_t x, const std::size_t y) const
+    {
+        if(width_chunk_ <= x || height_chunk_ <= y)
+        {
+            throw std::out_of_range("haywire::world::chunk_at: chunk (" +
+                std::to_string(x) + ", " + std::to_string(y) + ") is out of " +
+                std::to_string(width_chunk_) + "x" + std::to_string(height_chunk_));
+        }
+        return;
+    }
+
+    // chunks without margins, in row-major order.
+    std::vector<chunk_type> packed_chunks() const
+    {
+        std::vector<chunk_type> chunks;
+        chunks.reserve(width_chunk_ * height_chunk_);
+        for(std::size_t y=0; y<height_chunk_; ++y)
+        {
+            for(std::size_t x=0; x<width_chunk_; ++x)
+            {
+                chunks.push_back(chunks_[this->index(x, y)]);
+            }
+        }
+        return chunks;
+    }
+
+    void reallocate(const std::size_t left,   const std::size_t right,
+                    const std::size_t top,    const std::size_t bottom)
     {
-        chunks_buf_.resize(chunks_.size() + this->width_chunk_);
-        std::fill(chunks_buf_.begin(), chunks_buf_.end(), chunk{});
+        constexpr std::size_t min_margin = 4;
+        const std::size_t width_chunk  = width_chunk_  + left + right;
+        const std::size_t height_chunk = height_chunk_ + top  + bottom;
+        const std::size_t margin_x = std::max(width_chunk  / 2, min_margin);
+        const std::size_t margin_y = std::max(height_chunk / 2, min_margin);
+
+        const std::size_t stride          = round_up_to_tile(width_chunk  + 2 * margin_x);
+        const std::size_t capacity_height = round_up_to_tile(height_chunk + 2 * margin_y);
+        // the position of the current chunk (0, 0) in the new storage
+        const std::size_t offset_x = margin_x + left;
+        const std::size_t offset_y = margin_y + top;
+        const auto new_index = [=](const std::size_t old) noexcept {
+            const auto [x, y] = this->position_of(old);
+            return Layout::index(x + offset_x, y + offset_y, stride);
+        };
 
-        if(dir == direction::plus)
+        storage_type chunks    (stride * capacity_height);
+        storage_type chunks_buf(stride * capacity_height);
+        std::vector<std::uint64_t> hashes (stride * capacity_height, 0u);
+        std::vector<state_mask> summaries (stride * capacity_height, 0u);
+        hashes_   .resize(chunks_.size(), 0u);
+        summaries_.resize(chunks_.size(), 0u);
+        for(std::size_t y=0; y<height_chunk_; ++y)
         {
-            for(std::uint32_t y = 0; y < this->height_chunk_; ++y)
+            for(std::size_t x=0; x<width_chunk_; ++x)
             {
-                for(std::uint32_t x = 0; x < this->width_chunk_; ++x)
+                const std::size_t from = this->index(x, y);
+                const std::size_t to   = Layout::index(x + offset_x, y + offset_y, stride);
+                chunks    [to] = chunks_    [from];
+                chunks_buf[to] = chunks_buf_[from];
+                hashes    [to] = hashes_    [from];
+                summaries [to] = summaries_ [from];
+            }
+        }
+        for(auto& idx : active_)  {idx = new_index(idx);}
+        for(auto& idx : targets_) {idx = new_index(idx);}
+        for(auto& idx : dirty_)   {idx = new_index(idx);}
+        for(auto& idx : edited_)  {idx = new_index(idx);}
+        for(auto& idx : changed_) {idx = new_index(idx);}
+
+        this->chunks_     = std::move(chunks);
+        this->chunks_buf_ = std::move(chunks_buf);
+        this->hashes_     = std::move(hashes);
+        this->summaries_  = std::move(summaries);
+        this->flags_.assign(chunks_.size(), 0u);
+        for(const auto idx : active_)
+        {
+            flags_[idx] |= flag_active;
+        }
+        for(const auto idx : dirty_)
+        {
+            flags_[idx] |= flag_dirty;
+        }
+        for(const auto idx : edited_)
+        {
+            flags_[idx] |= flag_edited;
+        }
+        this->stride_          = stride;
+        this->capacity_height_ = capacity_height;
+        this->offset_x_        = offset_x;
+        this->offset_y_        = offset_y;
+        // the storage was copied anyway. queued chunks are in the groups
+        // built from summaries_.
+        this->overview_queue_.clear();
+        this->rebuild_overview();
+        return;
+    }
+
+    // update cells in a chunk and write them into chunks_buf_.
+    // returns the number of heads and tails in the updated chunk.
+    //
+    // The chunk and the edges of its neighbors are copied into a tile with a
+    // halo of one cell, so that every cell reads its neighbors at fixed
+    // offsets. Neighbors outside of the world are regarded as vacuum.
+    std::pair<std::size_t, std::size_t>
+    update_chunk(const std::size_t x_chk, const std::size_t y_chk)
+    {
+        constexpr std::size_t tile_width  = W + 2;
+        constexpr std::size_t tile_height = H + 2;
+
+        const bool has_left   = 0 < x_chk;
+        const bool has_right  = x_chk + 1 < width_chunk_;
+        const bool has_top    = 0 < y_chk;
+        const bool has_bottom = y_chk + 1 < height_chunk_;
+        const auto neighbor = [this, x_chk, y_chk](const int dx, const int dy)
+            -> const chunk_type& {
+            return chunks_[this->index(x_chk + dx, y_chk + dy)];
+        };
+
+        std::array<state, tile_width * tile_height> tile;
+        tile.fill(state::vacuum);
+
+        const auto& curr = chunks_[this->index(x_chk, y_chk)];
+        for(std::size_t y=0; y<H; ++y)
+        {
+            std::copy_n(curr.cells.begin() + W * y, W,
+                        tile.begin() + tile_width * (y + 1) + 1);
+        }
+        if(has_top)
+        {
+            const auto& ch = neighbor(0, -1);
+            std::copy_n(ch.cells.begin() + W * (H - 1), W, tile.begin() + 1);
+        }
+        if(has_bottom)
+        {
+            const auto& ch = neighbor(0, 1);
+            std::copy_n(ch.cells.begin(), W, tile.begin() + tile_width * (H + 1) + 1);
+        }
+        if(has_left)
+        {
+            const auto& ch = neighbor(-1, 0);
+            for(std::size_t y=0; y<H; ++y)
+            {
+                tile[tile_width * (y + 1)] = ch(W - 1, y);
+            }
+        }
+        if(has_right)
+        {
+            const auto& ch = neighbor(1, 0);
+            for(std::size_t y=0; y<H; ++y)
+            {
+                tile[tile_width * (y + 1) + W + 1] = ch(0, y);
+            }
+        }
+        if(has_top    && has_left ) {tile[0]                          = neighbor(-1, -1)(W - 1, H - 1);}
+        if(has_top    && has_right) {tile[W + 1]                      = neighbor( 1, -1)(0,     H - 1);}
+        if(has_bottom && has_left ) {tile[tile_width * (H + 1)]         = neighbor(-1,  1)(W - 1, 0);}
+        if(has_bottom && has_right) {tile[tile_width * (H + 1) + W + 1] = neighbor( 1,  1)(0,     0);}
+
+        // the next state of vacuum, wire (if it does not fire), head and tail
+        constexpr std::array<state, 4> after{{
+            state::vacuum, state::wire, state::tail, state::wire
+        }};
+
+        constexpr std::ptrdiff_t dy = tile_width;
+        auto& next = chunks_buf_[this->index(x_chk, y_chk)];
+        std::size_t heads = 0, tails = 0;
+        for(std::size_t y=0; y<H; ++y)
+        {
+            const state* row = tile.data() + tile_width * (y + 1) + 1;
+            for(std::size_t x=0; x<W; ++x)
+            {
+                const state* c = row + x;
+                const int count =
+                    static_cast<int>(c[-dy-1] == state::head) +
+                    static_cast<int>(c[-dy  ] == state::head) +
+                    static_cast<int>(c[-dy+1] == state::head) +
+                    static_cast<int>(c[   -1] == state::head) +
+                    static_cast<int>(c[   +1] == state::head) +
+                    static_cast<int>(c[ dy-1] == state::head) +
+                    static_cast<int>(c[ dy  ] == state::head) +
+                    static_cast<int>(c[ dy+1] == state::head);
+                const bool fires = (*c == state::wire) && (count == 1 || count == 2);
+                const state s = fires ? state::head : after[*c];
+                next.cells[W * y + x] = s;
+                heads += (s == state::head);
+                tails += (s == state::tail);
+            }
+        }
+        return std::make_pair(heads, tails);
+    }
+
+    static std::uint64_t mix(std::uint64_t x) noexcept // splitmix64
+    {
+        x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27; x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // 0 if the chunk has only vacuum.
+    std::uint64_t hash_of(const std::size_t idx, const chunk_type& ch) const noexcept
+    {
+        constexpr std::size_t n = W * H;
+        const auto [x_chk, y_chk] = this->position_of(idx);
+        const std::int64_t x = static_cast<std::int64_t>(x_chk) - origin_x_ / static_cast<std::int64_t>(W);
+        const std::int64_t y = static_cast<std::int64_t>(y_chk) - origin_y_ / static_cast<std::int64_t>(H);
+
+        // words are hashed independently and then summed up, so that the
+        // loop does not have a long chain of dependency
+        std::uint64_t sum = 0, any = 0;
+        for(std::size_t i=0; i<n; i+=8)
+        {
+            std::uint64_t word = 0;
+            std::memcpy(&word, ch.cells.data() + i, std::min<std::size_t>(8, n - i));
+            any |= word;
+            const std::uint64_t v = (word ^ (i * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+            sum += v ^ (v >> 31);
+        }
+        if(any == 0)
+        {
+            return 0;
+        }
+        return mix(sum + mix(static_cast<std::uint64_t>(x) * 0x9E3779B97F4A7C15ull ^
+                             static_cast<std::uint64_t>(y)));
+    }
+
+    // the low and high bits of the states are compared 8 cells at a time
+    static state_mask mask_of(const chunk_type& ch) noexcept
+    {
+        constexpr std::size_t n = W * H;
+        constexpr std::uint64_t ones = 0x0101010101010101ull;
+        std::uint64_t wire = 0, head = 0, tail = 0;
+        for(std::size_t i=0; i<n; i+=8)
+        {
+            std::uint64_t word = 0;
+            std::memcpy(&word, ch.cells.data() + i, std::min<std::size_t>(8, n - i));
+            const std::uint64_t lo = word & ones;
+            const std::uint64_t hi = (word >> 1) & ones;
+            wire |= lo & ~hi;
+            head |= hi & ~lo;
+            tail |= lo &  hi;
+        }
+        return static_cast<state_mask>(((wire != 0) << state::wire) |
+                                       ((head != 0) << state::head) |
+                                       ((tail != 0) << state::tail));
+    }
+
+    // the overview covers the storage, margins included
+    std::size_t overview_width(const std::size_t level) const noexcept
+    {
+        return (stride_          + (std::size_t(1) << level) - 1) >> level;
+    }
+    std::size_t overview_height(const std::size_t level) const noexcept
+    {
+        return (capacity_height_ + (std::size_t(1) << level) - 1) >> level;
+    }
+
+    // the mask of a group from the 4 groups in the level below
+    state_mask summarize_group(const std::size_t level, const std::size_t x, const std::size_t y) const noexcept
+    {
+        return this->overview(level - 1, 2 * x,     2 * y    ) |
+               this->overview(level - 1, 2 * x + 1, 2 * y    ) |
+               this->overview(level - 1, 2 * x,     2 * y + 1) |
+               this->overview(level - 1, 2 * x + 1, 2 * y + 1);
+    }
+
+    void summarize(const std::size_t idx, const chunk_type& ch)
+    {
+        const auto mask = mask_of(ch);
+        if(mask != summaries_[idx])
+        {
+            this->summaries_[idx] = mask;
+            this->overview_queue_.push_back(Layout::position(idx, stride_));
+        }
+        return;
+    }
+
+    // re-summarizes the groups that contain the chunks in the queue, level by
+    // level. A group whose mask does not change stops the propagation. The
+    // groups are de-duplicated by marking them queued instead of sorting.
+    void propagate_overview()
+    {
+        auto& nodes = this->overview_queue_;
+        for(std::size_t level=1; level <= overview_.size() && not nodes.empty(); ++level)
+        {
+            const std::size_t w = this->overview_width(level);
+            auto& masks = this->overview_[level - 1];
+
+            std::size_t n = 0;
+            for(std::size_t i=0; i<nodes.size(); ++i)
+            {
+                const std::size_t x = nodes[i].first  / 2;
+                const std::size_t y = nodes[i].second / 2;
+                if((masks[w * y + x] & overview_queued) == 0)
+                {
+                    masks[w * y + x] |= overview_queued;
+                    nodes[n++] = std::make_pair(x, y);
+                }
+            }
+            nodes.resize(n);
+
+            n = 0;
+            for(std::size_t i=0; i<nodes.size(); ++i)
+            {
+                const auto [x, y] = nodes[i];
+                const auto mask = this->summarize_group(level, x, y);
+                auto& dst = masks[w * y + x];
+                const bool is_changed = (mask != (dst & ~overview_queued));
+                dst = mask;
+                if(is_changed)
                 {
-                    chunks_buf_.at(this->width_chunk_ * y + x) =
-                        chunks_.at(this->width_chunk_ * y + x);
+                    nodes[n++] = std::make_pair(x, y);
                 }
             }
+            nodes.resize(n);
         }
-        else
+        nodes.clear();
+        return;
+    }
+
+    // builds the levels above chunks from summaries_
+    void rebuild_overview()
+    {
+        this->overview_.clear();
+        for(std::size_t level=1; 1 < this->overview_width(level - 1) ||
+                                 1 < this->overview_height(level - 1); ++level)
         {
-            for(std::uint32_t y = 0; y < this->height_chunk_; ++y)
+            const std::size_t w = this->overview_width(level);
+            const std::size_t h = this->overview_height(level);
+            std::vector<state_mask> masks(w * h, 0u);
+            for(std::size_t y=0; y<h; ++y)
             {
-                for(std::uint32_t x = 0; x < this->width_chunk_; ++x)
+                for(std::size_t x=0; x<w; ++x)
                 {
-                    // chunks are expanded to the minus direction
-                    chunks_buf_.at(this->width_chunk_ * (y+1) + x) =
-                        chunks_.at(this->width_chunk_ *  y    + x);
+                    masks[w * y + x] = this->summarize_group(level, x, y);
                 }
             }
+            this->overview_.push_back(std::move(masks));
+        }
+        return;
+    }
+
+    // the number of cells in each state
+    static std::array<std::int64_t, 4> count_states(const chunk_type& ch) noexcept
+    {
+        std::array<std::int64_t, 4> counts{{0, 0, 0, 0}};
+        for(const state s : ch.cells)
+        {
+            counts[s] += 1;
         }
-        chunks_ = chunks_buf_;
-        this->height_chunk_ += 1;
-        this->height_        = chunk::height * height_chunk_;
+        return counts;
+    }
+
+    // adds the cells in the edited chunks after the edits and updates their
+    // hashes and summaries. The groups of the overview are queued.
+    void apply_edits()
+    {
+        for(const std::size_t idx : edited_)
+        {
+            flags_[idx] &= ~flag_edited;
+            const auto counts = count_states(chunks_[idx]);
+            this->edited_conductors_ += counts[state::wire] + counts[state::head] +
+                                        counts[state::tail];
+            this->edited_heads_      += counts[state::head];
+            this->edited_tails_      += counts[state::tail];
 
-        assert(chunks_.size() == this->width_chunk_ * this->height_chunk_);
+            const auto hash = this->hash_of(idx, chunks_[idx]);
+            this->hash_ += hash - hashes_[idx];
+            this->hashes_[idx] = hash;
+            this->summarize(idx, chunks_[idx]);
+        }
+        edited_.clear();
+        this->num_conductors_ += edited_conductors_;
+        this->num_heads_      += edited_heads_;
+        this->num_tails_      += edited_tails_;
+        this->edited_conductors_ = 0;
+        this->edited_heads_      = 0;
+        this->edited_tails_      = 0;
         return;
     }
 
-    std::size_t width()  const noexcept {return width_ ;}
-    std::size_t height() const noexcept {return height_;}
+    // a chunk might be modified from outside. update it in the next step.
+    void activate(const std::size_t idx)
+    {
+        if(flags_.size() <= idx)
+        {
+            flags_.resize(chunks_.size(), 0u);
+        }
+        if((flags_[idx] & flag_active) == 0)
+        {
+            flags_[idx] |= flag_active;
+            active_.push_back(idx);
+        }
+        // cells in the chunk before the edit are subtracted here and the ones
+        // after the edit are added in the next update() or recount_edited().
+        if((flags_[idx] & flag_edited) == 0)
+        {
+            flags_[idx] |= flag_edited;
+            edited_.push_back(idx);
+            const auto counts = count_states(chunks_[idx]);
+            this->edited_conductors_ -= counts[state::wire] + counts[state::head] +
+                                        counts[state::tail];
+            this->edited_heads_      -= counts[state::head];
+            this->edited_tails_      -= counts[state::tail];
+        }
+        this->mark_dirty(idx);
+        return;
+    }
+
+    void mark_dirty(const std::size_t idx)
+    {
+        if(not is_all_dirty_ && (flags_[idx] & flag_dirty) == 0)
+        {
+            flags_[idx] |= flag_dirty;
+            dirty_.push_back(idx);
+        }
+        return;
+    }
+
+    // re-construct the set of active chunks from scratch.
+    // chunks_buf_ must be the same as chunks_.
+    void reset_activity()
+    {
+        flags_.assign(chunks_.size(), 0u);
+        active_.clear();
+        targets_.clear();
+        dirty_.clear();
+        edited_.clear();
+        changed_.clear();
+        this->is_all_dirty_ = true;
+        for(std::size_t idx=0; idx<chunks_.size(); ++idx)
+        {
+            const auto& cells = chunks_[idx].cells;
+            if(std::any_of(cells.begin(), cells.end(), [](const state s) noexcept {
+                    return s == state::head || s == state::tail;
+                }))
+            {
+                flags_[idx] |= flag_active;
+                active_.push_back(idx);
+            }
+        }
+        this->recount();
+        return;
+    }
 
   private:
+
+    static constexpr inline std::uint8_t flag_active  = 0x01;
+    static constexpr inline std::uint8_t flag_target  = 0x02;
+    static constexpr inline std::uint8_t flag_dirty   = 0x04; // in dirty_
+    static constexpr inline std::uint8_t flag_changed = 0x08; // in the last step
+    static constexpr inline std::uint8_t flag_edited  = 0x10; // in edited_
+    static constexpr inline std::uint8_t flag_summary = 0x20; // mask changed in the step
+
+    static constexpr inline state_mask overview_queued = 0x80; // only in propagate_overview()
+
+    // number of chunks in a task given to a thread
+    static constexpr inline std::size_t parallel_grain = 32;
+
     std::size_t width_, height_, width_chunk_, height_chunk_;
-    std::vector<chunk>  chunks_;
-    std::vector<chunk>  chunks_buf_;
+    std::size_t stride_, capacity_height_; // including margins
+    std::size_t offset_x_, offset_y_;      // position of chunk (0, 0)
+    std::int64_t origin_x_, origin_y_;
+    storage_type             chunks_;
+    storage_type             chunks_buf_;
+
+    // chunks_buf_ of chunks in targets_ holds an older state than chunks_.
+    // Other chunks in chunks_buf_ are the same as chunks_.
+    std::vector<std::uint8_t> flags_;
+    std::vector<std::size_t>  active_;      // chunks that have head or tail
+    std::vector<std::size_t>  targets_;     // chunks updated in the last step
+    std::vector<std::size_t>  targets_buf_;
+    std::vector<std::size_t>  dirty_;
+    std::vector<std::size_t>  changed_;     // chunks changed in the last step
+    bool                      is_all_dirty_ = true;
+
+    // cells are re-counted only in the edited chunks
+    std::vector<std::size_t>  edited_;                // since the last update
+    std::int64_t              edited_conductors_ = 0; // change by the edits
+    std::int64_t              edited_heads_      = 0;
+    std::int64_t              edited_tails_      = 0;
+    std::size_t               num_conductors_    = 0;
+    std::size_t               num_heads_         = 0;
+    std::size_t               num_tails_         = 0;
+    std::size_t               generation_        = 0;
+    double                    update_seconds_    = 0.0;
+
+    std::vector<std::uint64_t> hashes_; // of each chunk
+    std::uint64_t              hash_ = 0;
+
+    std::vector<state_mask>               summaries_; // of each chunk
+    std::vector<std::vector<state_mask>>  overview_;  // level 1, 2, ... in row-major order
+    std::vector<std::pair<std::size_t, std::size_t>> overview_queue_; // chunks to propagate
+
+    std::vector<port>            ports_;
+    std::shared_ptr<thread_pool> pool_;
+    std::size_t                  published_memory_ = 0; // of the source of publish_to()
 };
 
+// tiles of 8x8 chunks if HAYWIRE_TILED_LAYOUT is defined. On the boards of
+// `haywire-headless --bench` the row-major layout is faster, so it is the default.
+#if defined(HAYWIRE_TILED_LAYOUT)
+using world = basic_world<8, 8, tiled_layout<8>>;
+#else
+using world = basic_world<8, 8>;
+#endif
+
 } // haywire
 #endif// HAYWIRE_WORLD_HPP
@@ -0,0 +1,917 @@
+#include <haywire/world.hpp>
+#include <haywire/sparse_world.hpp>
+#include <haywire/engine.hpp>
+#include <haywire/batch.hpp>
+#include <haywire/circuits.hpp>
+#include <haywire/snapshot.hpp>
+#include <haywire/rle.hpp>
+#include <haywire/cycle.hpp>
+#include <haywire/testbench.hpp>
+#include <extlib/wad/wad/default_archiver.hpp>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+using haywire::engine_kind;
+using haywire::engine_name;
+
+bool ends_with(const std::string& str, const std::string& suffix)
+{
+    return str.size() >= suffix.size() &&
+           str.substr(str.size() - suffix.size()) == suffix;
+}
+
+std::vector<std::string> split(const std::string& str, const char delim)
+{
+    std::vector<std::string> retval;
+    std::size_t first = 0;
+    while(true)
+    {
+        const auto last = str.find(delim, first);
+        retval.push_back(str.substr(first, last - first));
+        if(last == std::string::npos) {break;}
+        first = last + 1;
+    }
+    return retval;
+}
+
+// NAME,X,Y[,SCHEDULE[,repeat]]. A port with a schedule is an input.
+haywire::port parse_port(const std::string& spec, const haywire::port::kind_type kind)
+{
+    const auto fields = split(spec, ',');
+    const bool is_input = (kind == haywire::port::kind_type::input);
+    if(fields.size() < 3 || (is_input && fields.size() < 4) || 5 < fields.size() ||
+       (not is_input && 3 < fields.size()) ||
+       (fields.size() == 5 && fields[4] != "repeat"))
+    {
+        throw std::invalid_argument("invalid port: " + spec);
+    }
+    haywire::port p;
+    p.name = fields[0];
+    p.kind = kind;
+    p.x    = std::stoll(fields[1]);
+    p.y    = std::stoll(fields[2]);
+    if(is_input)
+    {
+        p.schedule = fields[3];
+        p.repeat   = (fields.size() == 5);
+    }
+    return p;
+}
+
+// in KiB. returns 0 if not available.
+std::size_t peak_memory()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {return 0;}
+#  if defined(__APPLE__)
+    return usage.ru_maxrss / 1024; // in bytes on mac
+#  else
+    return usage.ru_maxrss;
+#  endif
+#else
+    return 0;
+#endif
+}
+
+// writes the statistics as CSV if the file name ends with .csv, or JSON lines
+// otherwise.
+struct stats_writer
+{
+    explicit stats_writer(const std::string& fname)
+        : out_(fname), is_csv_(ends_with(fname, ".csv"))
+    {
+        if(is_csv_)
+        {
+            out_ << "generation,heads,tails,wires,active_chunks,width,height,"
+                    "memory,update_seconds\n";
+        }
+    }
+
+    bool good() const {return out_.good();}
+
+    void write(const haywire::world_statistics& s)
+    {
+        if(is_csv_)
+        {
+            out_ << s.generation << ',' << s.num_heads << ',' << s.num_tails << ','
+                 << s.num_wires << ',' << s.num_active_chunks << ',' << s.width << ','
+                 << s.height << ',' << s.memory << ',' << s.update_seconds << '\n';
+        }
+        else
+        {
+            out_ << "{\"generation\":" << s.generation << ",\"heads\":" << s.num_heads
+                 << ",\"tails\":" << s.num_tails << ",\"wires\":" << s.num_wires
+                 << ",\"active_chunks\":" << s.num_active_chunks
+                 << ",\"width\":" << s.width << ",\"height\":" << s.height
+                 << ",\"memory\":" << s.memory
+                 << ",\"update_seconds\":" << s.update_seconds << "}\n";
+        }
+        return;
+    }
+
+  private:
+    std::ofstream out_;
+    bool          is_csv_;
+};
+
+// advances `gens` generations by step(n) and returns the elapsed time in
+// seconds. If `stats` is given, it stops every `every` generations to store
+// the state into the world and write the statistics. The generation and the
+// update time in the statistics are counted in this run.
+template<typename World, typename Step, typename Store>
+double run_blocks(World& w, const std::size_t gens, stats_writer* stats,
+                  const std::size_t every, Step&& step, Store&& store)
+{
+    const std::size_t block = stats ? std::max<std::size_t>(every, 1) : gens;
+    double elapsed = 0.0;
+    for(std::size_t done=0; done < gens; )
+    {
+        const std::size_t n = std::min(block, gens - done);
+        const auto start = std::chrono::steady_clock::now();
+        step(n);
+        const auto stop = std::chrono::steady_clock::now();
+        const double sec = std::chrono::duration<double>(stop - start).count();
+        elapsed += sec;
+        done    += n;
+        if(stats)
+        {
+            store();
+            auto s = w.statistics();
+            s.generation     = done;
+            s.update_seconds = sec / n;
+            stats->write(s);
+        }
+    }
+    store();
+    return elapsed;
+}
+
+// runs `gens` generations and returns the elapsed time in seconds. If a cycle
+// detector is given, the chunk engine skips the whole periods once a cycle is
+// found. If a testbench is given, the chunk engine drives its ports.
+double run(haywire::world& w, const engine_kind engine, const std::size_t gens,
+           stats_writer* stats = nullptr, const std::size_t every = 1,
+           haywire::cycle_detector* detector = nullptr, haywire::testbench* bench = nullptr)
+{
+    if(engine == engine_kind::chunk && bench)
+    {
+        return run_blocks(w, gens, stats, every,
+            [&w, bench](const std::size_t n) {bench->run(w, n);},
+            [] {});
+    }
+    if(engine == engine_kind::chunk && detector)
+    {
+        std::uint64_t generation = 0;
+        return run_blocks(w, gens, stats, every,
+            [&w, &generation, detector](const std::size_t n) {
+                haywire::run_to(w, generation, generation + n, *detector);
+            },
+            [] {});
+    }
+    // hashlife advances all the generations in a block at once
+    const auto e = haywire::make_engine(engine, w);
+    e->step(0); // constructs the engine before the timing starts
+    return run_blocks(w, gens, stats, every,
+        [&e](const std::size_t n) {e->step(n);},
+        [&e] {e->store();});
+}
+
+// counts the last-level cache misses of this process while it is alive. If
+// the counter is not available, e.g. perf_event_paranoid forbids it, value()
+// returns nullopt.
+struct cache_miss_counter
+{
+    cache_miss_counter()
+    {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.inherit        = 1; // counts the worker threads created later
+        this->fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if(fd_ != -1)
+        {
+            ::ioctl(fd_, PERF_EVENT_IOC_RESET,  0);
+            ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    ~cache_miss_counter()
+    {
+#if defined(__linux__)
+        if(fd_ != -1) {::close(fd_);}
+#endif
+    }
+    cache_miss_counter(const cache_miss_counter&) = delete;
+    cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+
+    std::optional<std::uint64_t> value() const
+    {
+#if defined(__linux__)
+        std::uint64_t count = 0;
+        if(fd_ != -1 && ::read(fd_, &count, sizeof(count)) == sizeof(count))
+        {
+            return count;
+        }
+#endif
+        return std::nullopt;
+    }
+
+  private:
+    int fd_ = -1;
+};
+
+struct chunk_run
+{
+    double                       sec;
+    std::optional<std::uint64_t> cache_misses;
+};
+
+// copies the world into chunks of N x N cells stored in the layout and runs
+// the chunk engine.
+template<std::size_t N, typename Layout = haywire::row_major_layout>
+chunk_run run_chunk_size(const haywire::world& src, const std::size_t nthreads,
+                         const std::size_t gens)
+{
+    haywire::basic_world<N, N, Layout> w(src.width(), src.height());
+    for(std::size_t y=0; y<src.height(); ++y)
+    {
+        for(std::size_t x=0; x<src.width(); ++x)
+        {
+            const auto s = src(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y));
+            if(s != haywire::state::vacuum)
+            {
+                w(static_cast<std::int32_t>(x), static_cast<std::int32_t>(y)) = s;
+            }
+        }
+    }
+    w.set_num_threads(nthreads);
+    w.update(); // builds the lists of chunks before the timing starts
+
+    const cache_miss_counter counter;
+    const auto start = std::chrono::steady_clock::now();
+    for(std::size_t i=0; i<gens; ++i)
+    {
+        w.update();
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    return chunk_run{std::chrono::duration<double>(stop - start).count(), counter.value()};
+}
+
+// calls f() that returns false on an error, and reports an exception thrown
+// from it, e.g. by a parser, as an error.
+template<typename F>
+bool reporting_errors(F&& f)
+{
+    try
+    {
+        return f();
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool load(const std::string& fname, haywire::world& w)
+{
+    if(ends_with(fname, ".toml"))
+    {
+        w = haywire::world(toml::parse(fname));
+        return true;
+    }
+    else if(ends_with(fname, ".msg"))
+    {
+        wad::read_archiver src(fname);
+        return wad::load<wad::type::map>(src, "world", w);
+    }
+    else if(ends_with(fname, ".hwb"))
+    {
+        w = haywire::read_snapshot(fname);
+        return true;
+    }
+    else if(ends_with(fname, ".rle") || ends_with(fname, ".mcl"))
+    {
+        std::ifstream ifs(fname);
+        if(not ifs.good())
+        {
+            std::cerr << "file open error: " << fname << std::endl;
+            return false;
+        }
+        w = haywire::world(0, 0);
+        if(ends_with(fname, ".rle")) {haywire::read_rle(ifs, w);}
+        else                         {haywire::read_mcl(ifs, w);}
+        return true;
+    }
+    std::cerr << "unknown file format: " << fname << std::endl;
+    return false;
+}
+
+bool save(const std::string& fname, const haywire::world& w)
+{
+    if(ends_with(fname, ".toml"))
+    {
+        std::ofstream out(fname);
+        out << std::setw(160) << w.into_toml();
+        return out.good();
+    }
+    else if(ends_with(fname, ".msg"))
+    {
+        wad::write_archiver sink;
+        wad::save<wad::type::map>(sink, "world", w);
+        sink.dump(fname);
+        return true;
+    }
+    else if(ends_with(fname, ".hwb"))
+    {
+        haywire::write_snapshot(fname, w);
+        return true;
+    }
+    else if(ends_with(fname, ".rle") || ends_with(fname, ".mcl"))
+    {
+        std::ofstream out(fname);
+        if(ends_with(fname, ".rle")) {haywire::write_rle(out, w);}
+        else                         {haywire::write_mcl(out, w);}
+        return out.good();
+    }
+    std::cerr << "unknown file format: " << fname << std::endl;
+    return false;
+}
+
+// the sparse engine keeps only the non-empty chunks. Patterns and snapshots
+// are read into it directly, and .toml and .msg, which hold the whole
+// world, are converted after reading.
+bool load(const std::string& fname, haywire::sparse_world& w)
+{
+    if(ends_with(fname, ".hwb"))
+    {
+        const haywire::snapshot_reader reader(fname);
+        if(not reader.ports().empty())
+        {
+            std::cerr << "ports need the chunk engine" << std::endl;
+            return false;
+        }
+        w = reader.load_sparse();
+        return true;
+    }
+    else if(ends_with(fname, ".rle") || ends_with(fname, ".mcl"))
+    {
+        std::ifstream ifs(fname);
+        if(not ifs.good())
+        {
+            std::cerr << "file open error: " << fname << std::endl;
+            return false;
+        }
+        if(ends_with(fname, ".rle")) {haywire::read_rle(ifs, w);}
+        else                         {haywire::read_mcl(ifs, w);}
+        return true;
+    }
+    haywire::world dense(0, 0);
+    if(not load(fname, dense))
+    {
+        return false;
+    }
+    if(not dense.ports().empty())
+    {
+        std::cerr << "ports need the chunk engine" << std::endl;
+        return false;
+    }
+    w = haywire::sparse_world(dense);
+    return true;
+}
+
+bool save(const std::string& fname, const haywire::sparse_world& w)
+{
+    if(ends_with(fname, ".hwb"))
+    {
+        haywire::write_snapshot(fname, w);
+        return true;
+    }
+    else if(ends_with(fname, ".rle") || ends_with(fname, ".mcl"))
+    {
+        std::ofstream out(fname);
+        if(ends_with(fname, ".rle")) {haywire::write_rle(out, w);}
+        else                         {haywire::write_mcl(out, w);}
+        return out.good();
+    }
+    return save(fname, w.to_world());
+}
+
+// runs the sparse engine without a dense world. The size is the one of the
+// bounding box of the non-empty chunks.
+int run_sparse(const std::string& input, const std::size_t gens,
+               stats_writer* stats, const std::size_t every, const std::string& output)
+{
+    haywire::sparse_world w;
+    if(not reporting_errors([&] {return load(input, w);}))
+    {
+        return 1;
+    }
+    const double sec = run_blocks(w, gens, stats, every,
+        [&w](const std::size_t n) {
+            for(std::size_t i=0; i<n; ++i)
+            {
+                w.update();
+            }
+        },
+        [] {});
+    const auto s = w.statistics();
+    const double cells = static_cast<double>(s.width * s.height);
+
+    std::cout << "world:       " << s.width << " x " << s.height << " cells ("
+              << w.num_chunks() << " chunks)\n";
+    std::cout << "engine:      " << engine_name(engine_kind::sparse) << " (1 threads)\n";
+    std::cout << "generations: " << gens << '\n';
+    std::cout << "elapsed:     " << sec << " sec\n";
+    if(gens != 0)
+    {
+        std::cout << "gens/sec:    " << gens / sec << '\n';
+        std::cout << "cells/sec:   " << cells * gens / sec << '\n';
+    }
+    std::cout << "cells:       " << s.num_heads << " heads, " << s.num_tails
+              << " tails, " << s.num_wires << " wires\n";
+    std::cout << "peak memory: " << peak_memory() << " KiB" << std::endl;
+
+    if(not output.empty() && not reporting_errors([&] {return save(output, w);}))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+// runs all the canonical circuits with all the engines and thread counts.
+void bench(const std::size_t gens)
+{
+    struct circuit
+    {
+        std::string name;
+        std::function<haywire::world()> make;
+    };
+    const std::vector<circuit> suite = {
+        {"clock_loops", []{return haywire::circuits::clock_loops(1024, 1024);}},
+        {"diode_array", []{return haywire::circuits::diode_array(4096,  512);}},
+        {"random_mesh", []{return haywire::circuits::random_mesh(2048, 2048);}},
+    };
+
+    std::vector<std::size_t> threads{1};
+    const std::size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    for(std::size_t n=2; n < hw; n *= 2) {threads.push_back(n);}
+    if(hw > 1) {threads.push_back(hw);}
+
+    std::cout << std::left << std::setw(14) << "circuit"  << std::setw(12) << "size"
+              << std::setw(10) << "engine"   << std::setw(9)  << "threads"
+              << std::right << std::setw(14) << "gens/sec" << std::setw(14)
+              << "cells/sec" << std::endl;
+
+    const auto report = [gens](const circuit& c, const haywire::world& w,
+            const engine_kind engine, const std::size_t nthreads, const double sec)
+    {
+        const double cells = static_cast<double>(w.width() * w.height());
+        std::cout << std::left << std::setw(14) << c.name
+                  << std::setw(12) << (std::to_string(w.width()) + "x" +
+                                       std::to_string(w.height()))
+                  << std::setw(10) << engine_name(engine) << std::setw(9) << nthreads
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << gens / sec
+                  << std::scientific << std::setprecision(3)
+                  << std::setw(14) << cells * gens / sec
+                  << std::defaultfloat << std::endl;
+    };
+
+    for(const auto& c : suite)
+    {
+        for(const auto nthreads : threads)
+        {
+            auto w = c.make();
+            w.set_num_threads(nthreads);
+            report(c, w, engine_kind::chunk, nthreads, run(w, engine_kind::chunk, gens));
+        }
+        for(const auto engine : {engine_kind::bitplane, engine_kind::netlist,
+                                  engine_kind::hashlife, engine_kind::sparse})
+        {
+            auto w = c.make();
+            report(c, w, engine, 1, run(w, engine, gens));
+        }
+    }
+
+    // the chunk engine with different chunk sizes. The world size is rounded
+    // up to a multiple of the chunk size.
+    std::cout << '\n' << std::left << std::setw(14) << "circuit" << std::setw(12) << "chunk"
+              << std::setw(9) << "threads" << std::right << std::setw(14) << "gens/sec"
+              << std::setw(14) << "cells/sec" << std::endl;
+    for(const auto& c : suite)
+    {
+        const auto w = c.make();
+        const double cells = static_cast<double>(w.width() * w.height());
+        for(const auto nthreads : {std::size_t(1), threads.back()})
+        {
+            const std::pair<std::size_t, double> results[] = {
+                { 8, run_chunk_size< 8>(w, nthreads, gens).sec},
+                {16, run_chunk_size<16>(w, nthreads, gens).sec},
+                {32, run_chunk_size<32>(w, nthreads, gens).sec},
+                {64, run_chunk_size<64>(w, nthreads, gens).sec},
+            };
+            for(const auto& [size, sec] : results)
+            {
+                std::cout << std::left << std::setw(14) << c.name
+                          << std::setw(12) << (std::to_string(size) + "x" + std::to_string(size))
+                          << std::setw(9) << nthreads
+                          << std::right << std::fixed << std::setprecision(1)
+                          << std::setw(14) << gens / sec
+                          << std::scientific << std::setprecision(3)
+                          << std::setw(14) << cells * gens / sec
+                          << std::defaultfloat << std::endl;
+            }
+            if(threads.size() == 1) {break;}
+        }
+    }
+
+    // the storage layouts of chunks on wide boards, where a row of chunks does
+    // not fit in the cache. Cache misses are "-" if they cannot be counted.
+    const std::vector<circuit> wide = {
+        {"diode_array", []{return haywire::circuits::diode_array(32768,  256);}},
+        {"random_mesh", []{return haywire::circuits::random_mesh(16384,  512);}},
+        {"clock_loops", []{return haywire::circuits::clock_loops(16384,  256);}},
+    };
+    std::cout << '\n' << std::left << std::setw(14) << "circuit" << std::setw(12) << "size"
+              << std::setw(10) << "layout" << std::setw(9) << "threads"
+              << std::right << std::setw(14) << "gens/sec" << std::setw(14)
+              << "cells/sec" << std::setw(16) << "misses/gen" << std::endl;
+    for(const auto& c : wide)
+    {
+        const auto w = c.make();
+        const double cells = static_cast<double>(w.width() * w.height());
+        for(const auto nthreads : {std::size_t(1), threads.back()})
+        {
+            const std::pair<const char*, chunk_run> results[] = {
+                {"row",     run_chunk_size<8, haywire::row_major_layout>(w, nthreads, gens)},
+                {"tiled4",  run_chunk_size<8, haywire::tiled_layout<4>>(w, nthreads, gens)},
+                {"tiled8",  run_chunk_size<8, haywire::tiled_layout<8>>(w, nthreads, gens)},
+            };
+            for(const auto& [layout, r] : results)
+            {
+                std::cout << std::left << std::setw(14) << c.name
+                          << std::setw(12) << (std::to_string(w.width()) + "x" +
+                                               std::to_string(w.height()))
+                          << std::setw(10) << layout << std::setw(9) << nthreads
+                          << std::right << std::fixed << std::setprecision(1)
+                          << std::setw(14) << gens / r.sec
+                          << std::scientific << std::setprecision(3)
+                          << std::setw(14) << cells * gens / r.sec << std::setw(16);
+                if(r.cache_misses) {std::cout << static_cast<double>(*r.cache_misses) / gens;}
+                else               {std::cout << "-";}
+                std::cout << std::defaultfloat << std::endl;
+            }
+            if(threads.size() == 1) {break;}
+        }
+    }
+
+    // the batch engine runs many instances of smaller circuits at once. It is
+    // compared with the chunk engine running one instance.
+    constexpr std::size_t num_instances = 256;
+    const std::vector<circuit> small = {
+        {"clock_loops", []{return haywire::circuits::clock_loops(256, 256);}},
+        {"diode_array", []{return haywire::circuits::diode_array(512,  64);}},
+        {"random_mesh", []{return haywire::circuits::random_mesh(256, 256);}},
+    };
+    std::cout << '\n' << std::left << std::setw(14) << "circuit" << std::setw(12) << "size"
+              << std::setw(10) << "engine" << std::setw(11) << "instances"
+              << std::right << std::setw(18) << "instance-gens/sec" << std::endl;
+    for(const auto& c : small)
+    {
+        auto w = c.make();
+        const double single = run(w, engine_kind::chunk, gens);
+
+        haywire::batch_engine batch(c.make(), num_instances);
+        const auto start = std::chrono::steady_clock::now();
+        for(std::size_t i=0; i<gens; ++i)
+        {
+            batch.update();
+        }
+        const auto stop = std::chrono::steady_clock::now();
+        const double sec = std::chrono::duration<double>(stop - start).count();
+
+        for(const auto& [name, n, rate] : {std::make_tuple("chunk", std::size_t(1), gens / single),
+                                           std::make_tuple("batch", num_instances,
+                                                           num_instances * gens / sec)})
+        {
+            std::cout << std::left << std::setw(14) << c.name
+                      << std::setw(12) << (std::to_string(w.width()) + "x" +
+                                           std::to_string(w.height()))
+                      << std::setw(10) << name << std::setw(11) << n
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(18) << rate << std::defaultfloat << std::endl;
+        }
+    }
+    std::cout << "peak memory: " << peak_memory() << " KiB" << std::endl;
+    return;
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: ./haywire-headless [--engine=chunk|bitplane|netlist|hashlife|sparse] "
+                 "[--threads=N] [--generations=N] [--output=out.toml|.msg|.hwb|.rle|.mcl] "
+                 "[--stats=stats.csv|.jsonl] [--stats-every=N] [--detect-cycle] "
+                 "[--input=NAME,X,Y,SCHEDULE[,repeat]] [--probe=NAME,X,Y] "
+                 "[--probes=traces.txt] data.toml|.msg|.hwb|.rle|.mcl" << std::endl;
+    std::cerr << "       ./haywire-headless --validate=ENGINE [--validate-every=K] "
+                 "[--threads=N] [--generations=N] data.toml|.msg|.hwb|.rle|.mcl"
+              << std::endl;
+    std::cerr << "       ./haywire-headless --bench [--generations=N]"
+              << std::endl;
+    return;
+}
+
+} // anonymous
+
+int main(int argc, char **argv)
+{
+    engine_kind engine   = engine_kind::chunk;
+    bool        has_engine = false;
+    std::size_t gens     = 1000;
+    std::size_t nthreads = 1;
+    std::size_t every    = 1;
+    bool        run_bench = false;
+    bool        detect_cycle = false;
+    std::size_t validate_every = 64;
+    std::optional<engine_kind> validate;
+    std::string input, output, stats_file, probes_file;
+    std::vector<haywire::port> ports;
+
+    for(int i=1; i<argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        // std::stoul and parse_port throw on malformed numbers and ports
+        try
+        {
+            if(arg.substr(0, 9) == "--engine=")
+            {
+                const auto kind = haywire::engine_from_name(arg.substr(9));
+                if(not kind)
+                {
+                    std::cerr << "unknown engine: " << arg.substr(9) << std::endl;
+                    return 1;
+                }
+                engine = *kind;
+                has_engine = true;
+            }
+            else if(arg.substr(0, 14) == "--generations=")
+            {
+                gens = std::stoul(arg.substr(14));
+            }
+            else if(arg.substr(0, 10) == "--threads=")
+            {
+                nthreads = std::stoul(arg.substr(10));
+            }
+            else if(arg.substr(0, 9) == "--output=")
+            {
+                output = arg.substr(9);
+            }
+            else if(arg.substr(0, 8) == "--stats=")
+            {
+                stats_file = arg.substr(8);
+            }
+            else if(arg.substr(0, 14) == "--stats-every=")
+            {
+                every = std::stoul(arg.substr(14));
+            }
+            else if(arg.substr(0, 8) == "--input=")
+            {
+                ports.push_back(parse_port(arg.substr(8), haywire::port::kind_type::input));
+            }
+            else if(arg.substr(0, 8) == "--probe=")
+            {
+                ports.push_back(parse_port(arg.substr(8), haywire::port::kind_type::probe));
+            }
+            else if(arg.substr(0, 9) == "--probes=")
+            {
+                probes_file = arg.substr(9);
+            }
+            else if(arg.substr(0, 11) == "--validate=")
+            {
+                validate = haywire::engine_from_name(arg.substr(11));
+                if(not validate)
+                {
+                    std::cerr << "unknown engine: " << arg.substr(11) << std::endl;
+                    return 1;
+                }
+            }
+            else if(arg.substr(0, 17) == "--validate-every=")
+            {
+                validate_every = std::stoul(arg.substr(17));
+            }
+            else if(arg == "--detect-cycle")
+            {
+                detect_cycle = true;
+            }
+            else if(arg == "--bench")
+            {
+                run_bench = true;
+            }
+            else if(not arg.empty() && arg.front() == '-')
+            {
+                std::cerr << "unknown option: " << arg << std::endl;
+                print_usage();
+                return 1;
+            }
+            else
+            {
+                input = arg;
+            }
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "invalid argument: " << arg << " (" << e.what() << ")" << std::endl;
+            return 1;
+        }
+    }
+
+    if(run_bench)
+    {
+        bench(gens);
+        return 0;
+    }
+    if(input.empty())
+    {
+        print_usage();
+        return 1;
+    }
+
+    // the validation only compares the engines. Nothing is driven or written.
+    if(validate && (has_engine || not output.empty() || not stats_file.empty() ||
+                    not ports.empty() || not probes_file.empty() || detect_cycle))
+    {
+        std::cerr << "--validate cannot be used with --engine, --output, --stats, "
+                     "--input, --probe, --probes or --detect-cycle" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<stats_writer> stats;
+    if(not stats_file.empty())
+    {
+        stats = std::make_unique<stats_writer>(stats_file);
+        if(not stats->good())
+        {
+            std::cerr << "file open error: " << stats_file << std::endl;
+            return 1;
+        }
+    }
+
+    // the sparse engine runs on its own storage. It is validated against the
+    // chunk engine on the dense world below.
+    if(engine == engine_kind::sparse && not validate)
+    {
+        if(not ports.empty() || not probes_file.empty() || detect_cycle)
+        {
+            std::cerr << "ports, --probes and --detect-cycle need the chunk engine" << std::endl;
+            return 1;
+        }
+        return run_sparse(input, gens, stats.get(), every, output);
+    }
+
+    haywire::world w(0, 0);
+    if(not reporting_errors([&] {return load(input, w);}))
+    {
+        return 1;
+    }
+    w.set_num_threads(nthreads);
+    w.recount(); // patterns and snapshots are read into the cells directly
+
+    // runs the engine with the chunk engine and compares them every K generations
+    if(validate)
+    {
+        const auto diverged = haywire::cross_validate(w, *validate, gens, validate_every);
+        if(diverged)
+        {
+            std::cout << "validate:    " << engine_name(*validate) << " diverges from chunk at "
+                      << "generation " << diverged->generation << " in chunk ("
+                      << diverged->x << ", " << diverged->y << ")" << std::endl;
+            return 2;
+        }
+        std::cout << "validate:    " << engine_name(*validate) << " matches chunk for "
+                  << gens << " generations" << std::endl;
+        return 0;
+    }
+
+    // ports stored in the file are also driven. A port off the world or
+    // off a conductor is reported.
+    std::unique_ptr<haywire::testbench> bench;
+    try
+    {
+        for(auto& p : ports)
+        {
+            w.add_port(std::move(p));
+        }
+        if(not w.ports().empty())
+        {
+            if(engine != engine_kind::chunk)
+            {
+                std::cerr << "ports need the chunk engine" << std::endl;
+                return 1;
+            }
+            bench = std::make_unique<haywire::testbench>(w);
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if(not probes_file.empty() && not bench)
+    {
+        std::cerr << "--probes needs ports in the world or from --input/--probe" << std::endl;
+        return 1;
+    }
+    if(detect_cycle && (engine != engine_kind::chunk || bench))
+    {
+        std::cerr << "--detect-cycle needs the chunk engine without ports" << std::endl;
+        return 1;
+    }
+    std::unique_ptr<haywire::cycle_detector> detector;
+    if(detect_cycle)
+    {
+        detector = std::make_unique<haywire::cycle_detector>();
+    }
+
+    const double sec   = run(w, engine, gens, stats.get(), every, detector.get(),
+                             bench.get());
+    const double cells = static_cast<double>(w.width() * w.height());
+
+    std::cout << "world:       " << w.width() << " x " << w.height() << " cells\n";
+    std::cout << "engine:      " << engine_name(engine) << " (" << w.num_threads()
+              << " threads)\n";
+    std::cout << "generations: " << gens << '\n';
+    std::cout << "elapsed:     " << sec << " sec\n";
+    if(gens != 0)
+    {
+        std::cout << "gens/sec:    " << gens / sec << '\n';
+        std::cout << "cells/sec:   " << cells * gens / sec << '\n';
+    }
+    std::cout << "cells:       " << w.num_heads() << " heads, " << w.num_tails()
+              << " tails, " << w.num_wires() << " wires\n";
+    if(detector && detector->has_cycle())
+    {
+        std::cout << "cycle:       period " << detector->period() << ", phase "
+                  << detector->phase(gens) << " (from generation "
+                  << detector->start() << ")\n";
+    }
+    else if(detector)
+    {
+        std::cout << "cycle:       not found\n";
+    }
+    if(bench)
+    {
+        for(const auto& t : bench->traces())
+        {
+            std::cout << "probe:       " << t.name << " (" << t.x << ", " << t.y << "), "
+                      << t.count() << " heads\n";
+        }
+    }
+    std::cout << "peak memory: " << peak_memory() << " KiB" << std::endl;
+
+    if(bench && not probes_file.empty())
+    {
+        std::ofstream ofs(probes_file);
+        bench->write(ofs);
+        if(not ofs.good())
+        {
+            std::cerr << "file write error: " << probes_file << std::endl;
+            return 1;
+        }
+    }
+    if(not output.empty() && not reporting_errors([&] {return save(output, w);}))
+    {
+        return 1;
+    }
+    return 0;
+}
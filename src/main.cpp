@@ -1,23 +1,80 @@
 #include <haywire/world.hpp>
 #include <haywire/gui.hpp>
 #include <extlib/wad/wad/default_archiver.hpp>
+#include <exception>
+#include <string>
 
 int main(int argc, char **argv)
 {
-    std::cerr << "Usage: ./haywire [data.toml]" << std::endl;
+    std::cerr << "Usage: ./haywire [--engine=chunk|bitplane|netlist|hashlife|sparse] [--threads=N] [--steps-per-frame=N] [--autosave=SECONDS] [--stats] [data.toml|.msg|.hwb|.rle|.mcl]" << std::endl;
     std::cerr << "Space: toggle execution"      << std::endl;
     std::cerr << "Enter: step-by-step update"   << std::endl;
+    std::cerr << "Up/Down: double/halve the steps per frame" << std::endl;
+    std::cerr << "F: toggle running as fast as possible"     << std::endl;
+    std::cerr << "Left/Right: go back/forward a generation (Shift: 100)" << std::endl;
+    std::cerr << "Home: go back to the oldest generation in the history" << std::endl;
+    std::cerr << "I: toggle the statistics overlay"          << std::endl;
+    std::cerr << "Shift-drag: select, Ctrl-C/X/V: copy/cut/paste, Delete: clear" << std::endl;
+    std::cerr << "R/M: rotate/mirror the copied cells (Shift: the other way)"    << std::endl;
+    std::cerr << "Ctrl-S: save into haywire-<date>-<time>.hwb in the background" << std::endl;
 
     haywire::window win;
 
-    if(argc == 2)
+    for(int i=1; i<argc; ++i)
     {
-        const std::string fname(argv[1]);
-        if(fname.substr(fname.size() - 5) == ".toml")
+        const std::string arg(argv[i]);
+        if(arg.substr(0, 9) == "--engine=")
         {
-            win.load_toml(argv[1]);
+            const auto engine = haywire::engine_from_name(arg.substr(9));
+            if(not engine)
+            {
+                std::cerr << "unknown engine: " << arg.substr(9) << std::endl;
+                return 1;
+            }
+            win.use_engine(*engine);
+            continue;
+        }
+        if(arg == "--stats")
+        {
+            win.report_stats(true);
+            continue;
+        }
+        // std::stoul throws on a malformed number
+        try
+        {
+            if(arg.substr(0, 10) == "--threads=")
+            {
+                win.set_num_threads(std::stoul(arg.substr(10)));
+                continue;
+            }
+            if(arg.substr(0, 11) == "--autosave=")
+            {
+                win.set_autosave(std::chrono::seconds(std::stoul(arg.substr(11))));
+                continue;
+            }
+            if(arg.substr(0, 18) == "--steps-per-frame=")
+            {
+                win.set_steps_per_frame(std::stoul(arg.substr(18)));
+                continue;
+            }
         }
-        else if(fname.substr(fname.size() - 4) == ".msg")
+        catch(const std::exception& e)
+        {
+            std::cerr << "invalid argument: " << arg << " (" << e.what() << ")" << std::endl;
+            return 1;
+        }
+        if(not arg.empty() && arg.front() == '-')
+        {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return 1;
+        }
+
+        const std::string fname(arg);
+        if(fname.size() >= 5 && fname.substr(fname.size() - 5) == ".toml")
+        {
+            win.load_toml(fname);
+        }
+        else if(fname.size() >= 4 && fname.substr(fname.size() - 4) == ".msg")
         {
             wad::read_archiver src(fname);
             if(!wad::load(src, win))
@@ -25,6 +82,18 @@ int main(int argc, char **argv)
                 return 1;
             }
         }
+        else if(fname.size() >= 4 && fname.substr(fname.size() - 4) == ".hwb")
+        {
+            win.load_snapshot(fname);
+        }
+        else if(fname.size() >= 4 && fname.substr(fname.size() - 4) == ".rle")
+        {
+            win.load_rle(fname);
+        }
+        else if(fname.size() >= 4 && fname.substr(fname.size() - 4) == ".mcl")
+        {
+            win.load_mcl(fname);
+        }
     }
     while(win.update()) {}
 
@@ -0,0 +1,97 @@
+#include <haywire/world.hpp>
+#include <haywire/batch.hpp>
+#include <haywire/circuits.hpp>
+#include "check.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// batch_engine: each instance matches a world updated by world::update(). The
+// number of instances is not a multiple of 64 nor of 256, so the last word of
+// each node is partially used and follows the AVX2 words, if enabled.
+
+namespace
+{
+using haywire_test::check;
+using haywire_test::same_cells;
+
+constexpr std::size_t num_instances = 4 * 64 + 37;
+constexpr std::size_t generations   = 64;
+constexpr std::size_t every         = 16;
+
+// the instance k has k % 5 more heads than the layout at pseudo-random wires.
+std::vector<haywire::world> instances(const haywire::world& layout)
+{
+    std::vector<std::pair<std::int32_t, std::int32_t>> wires;
+    for(std::int32_t y=0; y<static_cast<std::int32_t>(layout.height()); ++y)
+    {
+        for(std::int32_t x=0; x<static_cast<std::int32_t>(layout.width()); ++x)
+        {
+            if(layout(x, y) == haywire::state::wire)
+            {
+                wires.emplace_back(x, y);
+            }
+        }
+    }
+    std::vector<haywire::world> worlds(num_instances, layout);
+    for(std::size_t k=0; k<num_instances; ++k)
+    {
+        for(std::size_t j=0; j < k % 5; ++j)
+        {
+            const auto [x, y] = wires[(k * 7919 + j * 104729) % wires.size()];
+            worlds[k](x, y) = haywire::state::head;
+        }
+    }
+    return worlds;
+}
+
+void run(const std::size_t num_threads)
+{
+    const auto layout = haywire::circuits::random_mesh(64, 48);
+    auto worlds = instances(layout);
+
+    haywire::batch_engine batch(layout, num_instances);
+    batch.set_num_threads(num_threads);
+    for(std::size_t k=0; k<num_instances; ++k)
+    {
+        batch.reset(k, worlds[k]);
+    }
+    check(batch.size() == num_instances && batch.lanes() == 5, "number of instances and lanes");
+
+    const std::string threads = " with " + std::to_string(num_threads) + " threads";
+    for(std::size_t g=1; g<=generations; ++g)
+    {
+        batch.update();
+        for(auto& w : worlds)
+        {
+            w.update();
+        }
+        if(g % every != 0)
+        {
+            continue;
+        }
+        std::size_t mismatches = 0;
+        for(std::size_t k=0; k<num_instances; ++k)
+        {
+            auto stored = layout;
+            batch.store(k, stored);
+            if(not same_cells(stored, worlds[k]) || batch.num_heads(k) != worlds[k].num_heads())
+            {
+                mismatches += 1;
+            }
+        }
+        check(mismatches == 0, std::to_string(mismatches) + " instances differ at generation " +
+                               std::to_string(g) + threads);
+    }
+    return;
+}
+
+} // anonymous
+
+int main()
+{
+    run(1);
+    run(4);
+    return haywire_test::failures();
+}
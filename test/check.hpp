@@ -0,0 +1,77 @@
+#ifndef HAYWIRE_TEST_CHECK_HPP
+#define HAYWIRE_TEST_CHECK_HPP
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// A test is a program that runs checks and returns the number of failures
+// from main(), so ctest reports it as failed if any check fails.
+
+namespace haywire_test
+{
+
+inline int& failures() noexcept
+{
+    static int n = 0;
+    return n;
+}
+
+inline void check(const bool ok, const std::string& what)
+{
+    if(not ok)
+    {
+        std::cerr << "failed: " << what << std::endl;
+        failures() += 1;
+    }
+    return;
+}
+
+// checks that f() throws Exception whose message starts with `prefix`.
+template<typename Exception, typename F>
+void check_throws(F&& f, const std::string& what, const std::string& prefix = "")
+{
+    try
+    {
+        f();
+    }
+    catch(const Exception& e)
+    {
+        check(std::string(e.what()).compare(0, prefix.size(), prefix) == 0,
+              what + ": unexpected message: " + e.what());
+        return;
+    }
+    catch(const std::exception& e)
+    {
+        check(false, what + ": unexpected exception: " + e.what());
+        return;
+    }
+    check(false, what + ": nothing is thrown");
+    return;
+}
+
+// compares the sizes and all the cells of two worlds.
+template<typename World>
+bool same_cells(const World& lhs, const World& rhs)
+{
+    if(lhs.width() != rhs.width() || lhs.height() != rhs.height())
+    {
+        return false;
+    }
+    for(std::size_t y=0; y<lhs.height(); ++y)
+    {
+        for(std::size_t x=0; x<lhs.width(); ++x)
+        {
+            const auto i = static_cast<std::int32_t>(x);
+            const auto j = static_cast<std::int32_t>(y);
+            if(lhs(i, j) != rhs(i, j))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // haywire_test
+#endif// HAYWIRE_TEST_CHECK_HPP
@@ -0,0 +1,70 @@
+#include <haywire/world.hpp>
+#include <haywire/engine.hpp>
+#include <haywire/circuits.hpp>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// runs an engine in lockstep with the chunk engine over the canonical
+// circuits and fails at the first divergence.
+//
+// usage: ./test-cross-validate ENGINE [--threads=N]
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: ./test-cross-validate ENGINE [--threads=N]" << std::endl;
+        return 1;
+    }
+    const auto engine = haywire::engine_from_name(argv[1]);
+    if(not engine)
+    {
+        std::cerr << "unknown engine: " << argv[1] << std::endl;
+        return 1;
+    }
+    std::size_t nthreads = 1;
+    for(int i=2; i<argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if(arg.substr(0, 10) == "--threads=")
+        {
+            nthreads = std::stoul(arg.substr(10));
+        }
+        else
+        {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // large enough that the threaded update is taken
+    const std::vector<std::pair<const char*, std::function<haywire::world()>>> circuits = {
+        {"clock_loops", []{return haywire::circuits::clock_loops(256, 256);}},
+        {"diode_array", []{return haywire::circuits::diode_array(1024, 128);}},
+        {"random_mesh", []{return haywire::circuits::random_mesh(256, 256);}},
+    };
+    constexpr std::size_t generations = 512;
+    constexpr std::size_t every       = 16;
+
+    int failures = 0;
+    for(const auto& [name, make] : circuits)
+    {
+        haywire::world w = make();
+        w.set_num_threads(nthreads);
+        if(const auto d = haywire::cross_validate(w, *engine, generations, every))
+        {
+            std::cerr << name << ": " << haywire::engine_name(*engine)
+                      << " diverged at generation " << d->generation
+                      << " in chunk (" << d->x << ", " << d->y << ")" << std::endl;
+            failures += 1;
+        }
+        else
+        {
+            std::cout << name << ": " << haywire::engine_name(*engine)
+                      << " matched for " << generations << " generations" << std::endl;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include <haywire/world.hpp>
+#include <haywire/cycle.hpp>
+#include <haywire/simulator.hpp>
+#include <haywire/circuits.hpp>
+#include "check.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// cycle detection: run_to() skips whole periods and ends in the same world as
+// plain update(), and the simulator seeks into the generations skipped over a
+// cycle, which are not recorded in the history.
+
+namespace
+{
+using haywire_test::check;
+using haywire_test::same_cells;
+
+void run_to()
+{
+    // clock_loops is periodic from the start. diode_array fills its wires
+    // first, so the cycle starts later.
+    const std::vector<std::pair<const char*, std::function<haywire::world()>>> circuits = {
+        {"clock_loops", []{return haywire::circuits::clock_loops(32, 32);}},
+        {"diode_array", []{return haywire::circuits::diode_array(64, 16);}},
+    };
+    constexpr std::uint64_t target = 20011;
+
+    for(const auto& [name, make] : circuits)
+    {
+        auto plain = make();
+        for(std::uint64_t g=0; g<target; ++g)
+        {
+            plain.update();
+        }
+
+        auto w = make();
+        std::uint64_t generation = 0;
+        haywire::cycle_detector detector;
+        const auto updates = haywire::run_to(w, generation, target, detector);
+
+        const std::string what(name);
+        check(detector.has_cycle(), what + ": a cycle is found");
+        check(generation == target, what + ": run_to reaches the target");
+        check(updates < 1000, what + ": whole periods are skipped (" +
+                              std::to_string(updates) + " updates)");
+        check(same_cells(w, plain) && w.hash() == plain.hash(),
+              what + ": run_to matches update()");
+        check(detector.phase(target) == detector.phase(target + detector.period()),
+              what + ": the phase repeats every period");
+    }
+
+    // a generation that does not follow the last one breaks the cycle
+    auto w = haywire::circuits::clock_loops(64, 64);
+    std::uint64_t generation = 0;
+    haywire::cycle_detector detector;
+    haywire::run_to(w, generation, 100, detector);
+    check(detector.has_cycle(), "a cycle is found in 100 generations");
+    detector.observe(generation + 2, w.hash());
+    check(not detector.has_cycle() && detector.skip(generation + 2, 1000) == generation + 2,
+          "a gap clears the cycle");
+    return;
+}
+
+// waits until the snapshot reflects all the commands pushed so far.
+const haywire::world& wait(haywire::simulator& sim)
+{
+    const auto n = sim.num_commands();
+    while(sim.snapshot_commands() < n)
+    {
+        sim.acquire();
+        std::this_thread::yield();
+    }
+    return sim.snapshot();
+}
+
+void seek()
+{
+    const auto initial = haywire::circuits::diode_array(128, 32);
+    haywire::simulator sim(initial);
+    sim.set_running(false);
+    sim.seek(0);
+    wait(sim);
+
+    // advancing far skips the periods, leaving a gap in the history
+    constexpr std::uint64_t far = 5003;
+    sim.seek(far);
+    wait(sim);
+    check(sim.snapshot_generation() == far, "seek forward over a cycle");
+
+    // generations in the gap, in the recorded part and the start
+    const std::vector<std::uint64_t> generations = {far, 2500, 4999, far - 1, 100, 0, 3001};
+    std::vector<haywire::world> expected(far + 1, haywire::world(0, 0));
+    auto w = initial;
+    for(std::uint64_t g=0; g<=far; ++g)
+    {
+        if(std::find(generations.begin(), generations.end(), g) != generations.end())
+        {
+            expected[g] = w;
+        }
+        w.update();
+    }
+    check(same_cells(sim.snapshot(), expected[far]), "cells after seeking forward");
+
+    for(const auto g : generations)
+    {
+        sim.seek(g);
+        const auto& snapshot = wait(sim);
+        check(sim.snapshot_generation() == g && same_cells(snapshot, expected[g]),
+              "seek to generation " + std::to_string(g));
+    }
+    return;
+}
+
+} // anonymous
+
+int main()
+{
+    run_to();
+    seek();
+    return haywire_test::failures();
+}
@@ -0,0 +1,152 @@
+#include <haywire/world.hpp>
+#include <haywire/history.hpp>
+#include <haywire/circuits.hpp>
+#include "check.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// history: every recorded generation is restored as it was, across edits and
+// resizes, and after the oldest frames are discarded.
+
+namespace
+{
+using haywire_test::check;
+using haywire_test::check_throws;
+using haywire_test::same_cells;
+
+constexpr std::uint64_t generations = 200;
+
+// runs a world for the generations and records it into the history. The world
+// is edited at 50, grows at 100 as an edit and at 150 before the update. Edits
+// are recorded after the update of the generation, as the simulator does. The
+// worlds of all the generations are returned.
+std::vector<haywire::world> record(haywire::history& h)
+{
+    auto w = haywire::circuits::random_mesh(64, 48);
+    w.update_overview();
+    std::vector<haywire::world> saved;
+    h.record(w, 0, true);
+    saved.push_back(w);
+    for(std::uint64_t g=1; g<=generations; ++g)
+    {
+        if(g == 150)
+        {
+            w.expand(0, 1, 0, 2);
+        }
+        w.update();
+        h.record(w, g, false);
+        if(g == 50)
+        {
+            w.fill(0, 0, 16, 1, haywire::state::wire);
+            w(0, 0) = haywire::state::head;
+        }
+        if(g == 100)
+        {
+            w.expand(1, 0, 2, 0);
+            w(0, 0) = haywire::state::wire;
+        }
+        if(g == 50 || g == 100)
+        {
+            w.update_overview();
+            h.record(w, g, true);
+        }
+        saved.push_back(w);
+    }
+    return saved;
+}
+
+// the counts of the cells are compared after recount(), since they are not
+// updated by edits until the next update().
+bool restores(const haywire::history& h, haywire::world expected, const std::uint64_t g)
+{
+    const auto w = h.restore(g);
+    expected.recount();
+    return same_cells(w, expected) && w.origin_x() == expected.origin_x() &&
+           w.origin_y() == expected.origin_y() && w.num_heads() == expected.num_heads() &&
+           w.num_tails() == expected.num_tails();
+}
+
+void restore_all()
+{
+    haywire::history h(std::size_t(1) << 30, 16);
+    const auto saved = record(h);
+    check(h.size() == generations + 1 && h.oldest() == 0 && h.latest() == generations,
+          "all the generations are recorded");
+    for(std::uint64_t g=0; g<=generations; ++g)
+    {
+        check(restores(h, saved[g], g), "restore generation " + std::to_string(g));
+    }
+
+    // recording a past generation without an edit keeps the frames
+    h.record(saved[10], 10, false);
+    check(h.latest() == generations, "a recorded generation is kept");
+
+    // an edit discards the frames after it
+    h.record(saved[120], 120, true);
+    check(h.latest() == 120 && restores(h, saved[120], 120) && restores(h, saved[119], 119),
+          "an edited generation replaces the later ones");
+
+    check_throws<std::out_of_range>([&h] {h.restore(generations);},
+        "discarded generation", "haywire::history::restore: generation");
+    return;
+}
+
+// frames hold only the non-empty chunks and the edited ones, so a large
+// world with a few cells is cheap to record.
+void footprint()
+{
+    haywire::world w(1024, 1024);
+    w.fill(100, 100, 140, 101, haywire::state::wire);
+    w(100, 100) = haywire::state::head;
+    w.update_overview();
+
+    haywire::history h(std::size_t(1) << 30, 16);
+    h.record(w, 0, true);
+    check(h.memory_usage() < 1024, "a keyframe holds only the non-empty chunks (" +
+                                   std::to_string(h.memory_usage()) + " bytes)");
+    w.update();
+    h.record(w, 1, false);
+
+    const auto before = h.memory_usage();
+    w(900, 900) = haywire::state::wire;
+    w.update_overview();
+    h.record(w, 1, true);
+    check(h.size() == 2 && h.memory_usage() - before < 64,
+          "an edit is added to the frame as a delta (" +
+          std::to_string(h.memory_usage() - before) + " bytes)");
+    check(restores(h, w, 1), "restore an edited generation");
+    return;
+}
+
+void eviction()
+{
+    haywire::history full(std::size_t(1) << 30, 16);
+    record(full);
+
+    haywire::history h(full.memory_usage() / 4, 16);
+    const auto saved = record(h);
+    check(0 < h.oldest() && h.latest() == generations, "the oldest frames are discarded");
+    check(h.memory_usage() <= full.memory_usage() / 4, "within the memory limit");
+    check(not h.contains(h.oldest() - 1) && h.contains(h.oldest()),
+          "the history starts at a keyframe");
+    for(std::uint64_t g=h.oldest(); g<=generations; ++g)
+    {
+        check(restores(h, saved[g], g), "restore generation " + std::to_string(g) +
+                                        " after eviction");
+    }
+    check_throws<std::out_of_range>([&h] {h.restore(0);},
+        "evicted generation", "haywire::history::restore: generation");
+    return;
+}
+
+} // anonymous
+
+int main()
+{
+    restore_all();
+    footprint();
+    eviction();
+    return haywire_test::failures();
+}
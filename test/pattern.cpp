@@ -0,0 +1,109 @@
+#include <haywire/world.hpp>
+#include <haywire/sparse_world.hpp>
+#include <haywire/rle.hpp>
+#include <haywire/circuits.hpp>
+#include "check.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// RLE and MCL: round trips through a world and a sparse world, and
+// rejection of broken or oversized patterns.
+
+namespace
+{
+using haywire_test::check;
+using haywire_test::check_throws;
+using haywire_test::same_cells;
+
+haywire::world read_rle(const std::string& str)
+{
+    std::istringstream iss(str);
+    haywire::world w(0, 0);
+    haywire::read_rle(iss, w);
+    return w;
+}
+haywire::world read_mcl(const std::string& str)
+{
+    std::istringstream iss(str);
+    haywire::world w(0, 0);
+    haywire::read_mcl(iss, w);
+    return w;
+}
+
+void round_trip()
+{
+    const auto original = haywire::circuits::random_mesh(100, 60);
+
+    std::ostringstream rle;
+    haywire::write_rle(rle, original);
+    check(same_cells(read_rle(rle.str()), original), "RLE round trip");
+
+    std::ostringstream mcl;
+    haywire::write_mcl(mcl, original);
+    check(same_cells(read_mcl(mcl.str()), original), "MCL round trip");
+
+    // the sparse world writes the same cells
+    std::ostringstream sparse_rle, sparse_mcl;
+    haywire::write_rle(sparse_rle, haywire::sparse_world(original));
+    haywire::write_mcl(sparse_mcl, haywire::sparse_world(original));
+    check(same_cells(read_rle(sparse_rle.str()), original), "RLE round trip of a sparse world");
+    check(same_cells(read_mcl(sparse_mcl.str()), original), "MCL round trip of a sparse world");
+
+    // distant parts are kept without the cells in between
+    const std::string far = "x = 0, y = 0, rule = WireWorld\n"
+                            "CAB$999999999$999999984.BAC!\n";
+    std::istringstream iss(far);
+    haywire::sparse_world s;
+    haywire::read_rle(iss, s);
+    check(s.num_chunks() == 2, "a sparse world holds only the non-empty chunks");
+    check(s(999999984, 1000000000) == haywire::state::tail &&
+          s(999999986, 1000000000) == haywire::state::wire, "cells of a distant part");
+    return;
+}
+
+void rejection()
+{
+    const auto rle = [](const std::string& str) {
+        return [str] {read_rle(str);};
+    };
+    check_throws<std::runtime_error>(rle("x = a, y = 1\nC!\n"),
+        "non-numeric size", "haywire::read_rle: bad header");
+    check_throws<std::runtime_error>(rle("x = 3\nC!\n"),
+        "missing size", "haywire::read_rle: bad header");
+    check_throws<std::runtime_error>(rle("x = -3, y = 1\nC!\n"),
+        "negative size", "haywire::read_rle: bad header");
+    check_throws<std::runtime_error>(rle("x = 3000000000, y = 1\nC!\n"),
+        "size out of the range of the world", "haywire::read_rle: bad header");
+    check_throws<std::runtime_error>(rle("x = 3, y = 99999999999999999999999\nC!\n"),
+        "size out of int64", "haywire::read_rle: bad header");
+    check_throws<std::runtime_error>(rle("x = 3, y = 1, rule = B3/S23\nC!\n"),
+        "other rule", "haywire::read_rle: unsupported rule");
+    check_throws<std::runtime_error>(rle("x = 3, y = 1\n99999999999999999999999C!\n"),
+        "too long run", "haywire::pattern: too long run");
+    check_throws<std::runtime_error>(rle("x = 3, y = 1\n3000000000C!\n"),
+        "run out of the range of the world", "haywire::pattern: too long run");
+    check_throws<std::runtime_error>(rle("x = 3, y = 1\n2000000000$2000000000$C!\n"),
+        "rows out of the range of the world", "haywire::pattern: out of the range");
+    check_throws<std::runtime_error>(rle("x = 3, y = 1\nCXC!\n"),
+        "unknown state", "haywire::pattern: unsupported cell state");
+
+    check_throws<std::runtime_error>([] {read_mcl("#MCell 4.20\n#RULE 23/3\n#L CCC\n");},
+        "MCL of other rule", "haywire::read_mcl: unsupported rule");
+    check(read_mcl("#L CCC\n")(2, 0) == haywire::state::wire, "MCL without #RULE");
+
+    // the size in the header does not allocate the world
+    const auto huge = read_rle("x = 2000000000, y = 2000000000\nCAB!\n");
+    check(huge.width() <= 8 && huge.height() <= 8 && huge(1, 0) == haywire::state::head,
+          "a small pattern with a huge size in the header");
+    return;
+}
+
+} // anonymous
+
+int main()
+{
+    round_trip();
+    rejection();
+    return haywire_test::failures();
+}
@@ -0,0 +1,208 @@
+#include <haywire/world.hpp>
+#include "check.hpp"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+// region operations: fill, paste, copy and clear against a cell-by-cell
+// reference, including the ones that expand the world, and round trips of
+// the transforms of a pattern.
+
+namespace
+{
+using haywire_test::check;
+using haywire_test::same_cells;
+
+// cells keyed by the coordinates at construction, i.e. a cell (x, y) of the
+// world is at (x - origin_x(), y - origin_y()). Missing cells are vacuum.
+struct reference
+{
+    std::map<std::pair<std::int64_t, std::int64_t>, haywire::state> cells;
+
+    haywire::state operator()(const std::int64_t x, const std::int64_t y) const
+    {
+        const auto found = cells.find(std::make_pair(x, y));
+        return found == cells.end() ? haywire::state::vacuum : found->second;
+    }
+    void set(const std::int64_t x, const std::int64_t y, const haywire::state s)
+    {
+        cells[std::make_pair(x, y)] = s;
+        return;
+    }
+};
+
+// all the cells of the world match, and no cell of the reference is outside.
+bool matches(const haywire::world& w, const reference& ref)
+{
+    for(std::int32_t y=0; y<static_cast<std::int32_t>(w.height()); ++y)
+    {
+        for(std::int32_t x=0; x<static_cast<std::int32_t>(w.width()); ++x)
+        {
+            if(w(x, y) != ref(x - w.origin_x(), y - w.origin_y()))
+            {
+                return false;
+            }
+        }
+    }
+    for(const auto& [pos, s] : ref.cells)
+    {
+        const auto x = pos.first  + w.origin_x();
+        const auto y = pos.second + w.origin_y();
+        if(s != haywire::state::vacuum &&
+           (x < 0 || static_cast<std::int64_t>(w.width())  <= x ||
+            y < 0 || static_cast<std::int64_t>(w.height()) <= y))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// a pattern without symmetry, so that every transform changes it
+haywire::pattern asymmetric(const std::size_t width, const std::size_t height)
+{
+    haywire::pattern p(width, height);
+    for(std::size_t y=0; y<height; ++y)
+    {
+        for(std::size_t x=0; x<width; ++x)
+        {
+            p(x, y) = static_cast<haywire::state>((x * 3 + y * y + x * y) % 4);
+        }
+    }
+    return p;
+}
+
+void operations()
+{
+    haywire::world w(16, 16);
+    reference ref;
+
+    // fill over the left and top edges expands the world to the minus
+    // direction. The rectangle spans three chunks in x.
+    w.fill(-5, -3, 12, 2, haywire::state::wire);
+    for(std::int64_t y=-3; y<2; ++y)
+    {
+        for(std::int64_t x=-5; x<12; ++x)
+        {
+            ref.set(x, y, haywire::state::wire);
+        }
+    }
+    check(w.origin_x() == 8 && w.origin_y() == 8 && w.width() == 24 && w.height() == 24,
+          "fill at negative coordinates expands the world");
+    check(matches(w, ref), "cells after fill");
+
+    // paste over the right and top edges. (x, y) is in the coordinates before
+    // the expansion, and vacuum in the pattern overwrites the cells.
+    const auto p = asymmetric(13, 11);
+    {
+        const auto x = 20, y = -7;
+        const auto ox = w.origin_x(), oy = w.origin_y();
+        w.paste(p, x, y);
+        for(std::size_t j=0; j<p.height(); ++j)
+        {
+            for(std::size_t i=0; i<p.width(); ++i)
+            {
+                ref.set(x + std::int64_t(i) - ox, y + std::int64_t(j) - oy, p(i, j));
+            }
+        }
+    }
+    check(w.origin_x() == 8 && w.origin_y() == 16 && w.width() == 40 && w.height() == 32,
+          "paste over the edges expands the world");
+    check(matches(w, ref), "cells after paste");
+
+    // paste in the world does not expand it. The pattern crosses the
+    // boundaries of chunks in both directions.
+    {
+        const auto x = 6, y = 5;
+        const auto ox = w.origin_x(), oy = w.origin_y();
+        w.paste(p.rotated_clockwise(), x, y);
+        const auto q = p.rotated_clockwise();
+        for(std::size_t j=0; j<q.height(); ++j)
+        {
+            for(std::size_t i=0; i<q.width(); ++i)
+            {
+                ref.set(x + std::int64_t(i) - ox, y + std::int64_t(j) - oy, q(i, j));
+            }
+        }
+    }
+    check(w.width() == 40 && w.height() == 32, "paste inside does not expand the world");
+    check(matches(w, ref), "cells after paste inside");
+
+    // copy out of the world gives vacuum outside
+    {
+        const auto c = w.copy(-3, 2, 45, 30);
+        bool same = (c.width() == 48 && c.height() == 28);
+        for(std::size_t j=0; same && j<c.height(); ++j)
+        {
+            for(std::size_t i=0; same && i<c.width(); ++i)
+            {
+                same = (c(i, j) == ref(-3 + std::int64_t(i) - w.origin_x(),
+                                        2 + std::int64_t(j) - w.origin_y()));
+            }
+        }
+        check(same, "cells of a copy");
+    }
+
+    // clear never grows the world
+    {
+        const auto width = w.width(), height = w.height();
+        const auto ox = w.origin_x(), oy = w.origin_y();
+        w.clear(-100, 3, 13, 200);
+        for(std::int64_t y=3; y<static_cast<std::int64_t>(height); ++y)
+        {
+            for(std::int64_t x=0; x<13; ++x)
+            {
+                ref.set(x - ox, y - oy, haywire::state::vacuum);
+            }
+        }
+        check(w.width() == width && w.height() == height &&
+              w.origin_x() == ox && w.origin_y() == oy, "clear does not expand the world");
+        check(matches(w, ref), "cells after clear");
+
+        w.clear(-10, -10, -1, -1);
+        w.clear(100, 100, 200, 200);
+        check(w.width() == width && w.height() == height && matches(w, ref),
+              "clear out of the world does nothing");
+    }
+    return;
+}
+
+void transforms()
+{
+    const auto p = asymmetric(5, 3);
+
+    const auto cw = p.rotated_clockwise();
+    check(cw.width() == 3 && cw.height() == 5 && cw(2, 0) == p(0, 0) && cw(0, 4) == p(4, 2),
+          "clockwise rotation");
+    check(same_cells(cw.rotated_clockwise().rotated_clockwise().rotated_clockwise(), p),
+          "four clockwise rotations");
+    check(same_cells(p.rotated_counterclockwise().rotated_counterclockwise()
+                      .rotated_counterclockwise().rotated_counterclockwise(), p),
+          "four counterclockwise rotations");
+    check(same_cells(cw.rotated_counterclockwise(), p), "rotation back and forth");
+
+    const auto h = p.mirrored_horizontally();
+    check(not same_cells(h, p) && h(4, 0) == p(0, 0) && h(0, 2) == p(4, 2),
+          "horizontal mirror");
+    check(same_cells(h.mirrored_horizontally(), p), "horizontal mirror twice");
+
+    const auto v = p.mirrored_vertically();
+    check(not same_cells(v, p) && v(0, 2) == p(0, 0) && v(4, 0) == p(4, 2),
+          "vertical mirror");
+    check(same_cells(v.mirrored_vertically(), p), "vertical mirror twice");
+
+    // two mirrors are a half turn
+    check(same_cells(h.mirrored_vertically(), cw.rotated_clockwise()),
+          "both mirrors are a half turn");
+    return;
+}
+
+} // anonymous
+
+int main()
+{
+    operations();
+    transforms();
+    return haywire_test::failures();
+}
@@ -0,0 +1,220 @@
+#include <haywire/world.hpp>
+#include <haywire/snapshot.hpp>
+#include <haywire/circuits.hpp>
+#include "check.hpp"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// .hwb: round trips of an expanded world, loading a region, rejection of
+// truncated or corrupted files, and errors in writing.
+
+namespace
+{
+using haywire_test::check;
+using haywire_test::check_throws;
+using haywire_test::same_cells;
+
+bool same_ports(const std::vector<haywire::port>& lhs, const std::vector<haywire::port>& rhs)
+{
+    if(lhs.size() != rhs.size())
+    {
+        return false;
+    }
+    for(std::size_t i=0; i<lhs.size(); ++i)
+    {
+        if(lhs[i].name != rhs[i].name || lhs[i].kind != rhs[i].kind ||
+           lhs[i].x    != rhs[i].x    || lhs[i].y    != rhs[i].y    ||
+           lhs[i].schedule != rhs[i].schedule || lhs[i].repeat != rhs[i].repeat)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<char> read_bytes(const std::string& fname)
+{
+    std::ifstream ifs(fname, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(ifs),
+                             std::istreambuf_iterator<char>());
+}
+void write_bytes(const std::string& fname, const std::vector<char>& bytes)
+{
+    std::ofstream ofs(fname, std::ios::binary);
+    ofs.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return;
+}
+
+// a world that has grown to the left and the top, with cells in the new
+// chunks and ports
+haywire::world expanded_world()
+{
+    auto w = haywire::circuits::random_mesh(100, 60);
+    for(std::size_t i=0; i<10; ++i)
+    {
+        w.update();
+    }
+    w.expand(3, 1, 2, 1);
+    w.fill(0, 0, 5, 1, haywire::state::wire);
+    w(0, 0) = haywire::state::head;
+    w(1, 0) = haywire::state::tail;
+
+    haywire::port in;
+    in.name     = "in";
+    in.kind     = haywire::port::kind_type::input;
+    in.x        = 4;
+    in.y        = 0;
+    in.schedule = "1000100010";
+    in.repeat   = true;
+    w.add_port(in);
+
+    haywire::port out;
+    out.name = "out";
+    out.x    = 60;
+    out.y    = 40;
+    w.add_port(out);
+
+    w.update_overview();
+    return w;
+}
+
+void round_trip()
+{
+    const auto original = expanded_world();
+
+    haywire::write_snapshot("test-snapshot-world.hwb", original);
+    const auto from_world = haywire::read_snapshot("test-snapshot-world.hwb");
+    check(same_cells(from_world, original), "round trip of a world");
+    check(same_ports(from_world.ports(), original.ports()), "ports of a world");
+
+    haywire::write_snapshot("test-snapshot-packed.hwb", haywire::pack(original));
+    const auto from_packed = haywire::read_snapshot("test-snapshot-packed.hwb");
+    check(same_cells(from_packed, original), "round trip of a packed world");
+    check(same_ports(from_packed.ports(), original.ports()), "ports of a packed world");
+
+    // both write the same chunks
+    check(read_bytes("test-snapshot-world.hwb") == read_bytes("test-snapshot-packed.hwb"),
+          "a world and its packed world are written into the same bytes");
+    return;
+}
+
+void region()
+{
+    const auto original = expanded_world();
+    haywire::write_snapshot("test-snapshot-world.hwb", original);
+
+    const haywire::snapshot_reader reader("test-snapshot-world.hwb");
+    check(reader.width() == original.width() && reader.height() == original.height(),
+          "size in the header");
+
+    constexpr std::size_t x0 = 2, y0 = 1, x1 = 9, y1 = 6;
+    const auto part = reader.load(x0, y0, x1, y1);
+    check(part.width()  == (x1 - x0) * haywire::chunk::width &&
+          part.height() == (y1 - y0) * haywire::chunk::height, "size of a region");
+
+    const auto dx = static_cast<std::int32_t>(x0 * haywire::chunk::width);
+    const auto dy = static_cast<std::int32_t>(y0 * haywire::chunk::height);
+    bool matches = true;
+    for(std::int32_t y=0; y<static_cast<std::int32_t>(part.height()); ++y)
+    {
+        for(std::int32_t x=0; x<static_cast<std::int32_t>(part.width()); ++x)
+        {
+            matches = matches && (part(x, y) == original(x + dx, y + dy));
+        }
+    }
+    check(matches, "cells of a region");
+
+    // only the port inside the region is kept, relative to the region
+    check(part.ports().size() == 1 && part.ports().front().name == "out" &&
+          part.ports().front().x == 60 - dx && part.ports().front().y == 40 - dy,
+          "ports of a region");
+
+    check(reader.load(x0, y0, x0, y0).width() == 0, "an empty region");
+    check_throws<std::out_of_range>([&reader] {
+            reader.load(0, 0, reader.width() / haywire::chunk::width + 1, 1);
+        }, "region out of the world", "haywire::snapshot_reader::load: region out of range");
+    return;
+}
+
+void rejection()
+{
+    haywire::write_snapshot("test-snapshot-world.hwb", expanded_world());
+    const auto bytes = read_bytes("test-snapshot-world.hwb");
+    const auto load = [](const std::vector<char>& broken) {
+        return [broken] {
+            write_bytes("test-snapshot-broken.hwb", broken);
+            haywire::read_snapshot("test-snapshot-broken.hwb");
+        };
+    };
+
+    check_throws<std::runtime_error>([] {haywire::read_snapshot("test-snapshot-missing.hwb");},
+        "missing file", "haywire::mapped_file: file open error");
+    check_throws<std::runtime_error>(load(std::vector<char>(bytes.begin(), bytes.begin() + 20)),
+        "truncated header", "haywire::snapshot_reader: not a snapshot");
+    check_throws<std::runtime_error>(load(std::vector<char>(bytes.begin(), bytes.end() - 100)),
+        "truncated body", "haywire::snapshot_reader: truncated");
+
+    auto magic = bytes;
+    magic[0] = 'X';
+    check_throws<std::runtime_error>(load(magic),
+        "wrong magic", "haywire::snapshot_reader: not a snapshot");
+
+    auto version = bytes;
+    version[4] = 99;
+    check_throws<std::runtime_error>(load(version),
+        "unknown version", "haywire::snapshot_reader: unsupported version");
+
+    // the first entry of the chunk index points into the header
+    auto index = bytes;
+    std::uint64_t index_offset = 0;
+    for(std::size_t i=0; i<8; ++i)
+    {
+        index_offset |= static_cast<std::uint64_t>(static_cast<unsigned char>(bytes[24 + i])) << (8 * i);
+    }
+    for(std::size_t i=0; i<8; ++i)
+    {
+        index[index_offset + 8 + i] = 0;
+    }
+    check_throws<std::runtime_error>(load(index),
+        "broken chunk index", "haywire::snapshot_reader: broken chunk index");
+
+    // the number of ports is larger than what is stored
+    auto ports = bytes;
+    std::uint64_t ports_offset = 0;
+    for(std::size_t i=0; i<8; ++i)
+    {
+        ports_offset |= static_cast<std::uint64_t>(static_cast<unsigned char>(bytes[32 + i])) << (8 * i);
+    }
+    ports[ports_offset] = 100;
+    check_throws<std::runtime_error>(load(ports),
+        "broken ports", "haywire::snapshot_reader: broken ports");
+    return;
+}
+
+// an error in writing is reported, so that a broken file does not replace a
+// good one
+void write_error()
+{
+#if defined(__linux__)
+    check_throws<std::runtime_error>([] {
+            haywire::world w(8, 8);
+            w(0, 0) = haywire::state::wire;
+            haywire::write_snapshot("/dev/full", w);
+        }, "full disk", "haywire::write_snapshot: write error");
+#endif
+    return;
+}
+
+} // anonymous
+
+int main()
+{
+    round_trip();
+    region();
+    rejection();
+    write_error();
+    return haywire_test::failures();
+}